@@ -0,0 +1,129 @@
+/**
+ *  @file boot.c
+ *  @author TheFwGuy
+ *  @version 1.0
+ *  @date October 2026
+ *  @brief Boot stage timing
+ *
+ *  Every stage of the power up is timestamped in Boot_us[] and toggles the
+ *  P2.3 debug pin, so the sequence can be followed with a scope as well.
+ *  The 32kHz crystal is not stable yet for most of the boot, so the early
+ *  stages are timed by Timer B on SMCLK / 8 (10 us at the nominal DCO). Once
+ *  the crystal runs, InitTimer takes Timer B for the measurement mode and
+ *  the later stages are taken from the Timer_A time base, added to the
+ *  crystal stage.
+ *  The time to the first valid reading is the last stage.
+ */
+
+#include "system.h"
+#include "rpm.h"
+#include "boot.h"
+#include "hal.h"
+
+unsigned long Boot_us[BOOT_STAGES]; /* Time of every stage, us (0 = not reached) */
+unsigned char Boot_xtalOk;          /* Crystal started within BOOT_XTAL_MAX */
+
+static unsigned short BootHi;       /* Upper half of the stopwatch */
+
+/**
+ *  @fn BootStart
+ *  @brief The function starts the boot stopwatch
+ *
+ *  The debug pin is toggled here and at every stage up to BOOT_TIMER, an
+ *  even number of edges, so it is low again at the end of the boot.
+ *
+ *  @param none
+ *  @return none
+ */
+void BootStart(void)
+{
+   unsigned char i;
+
+   for(i = 0; i < BOOT_STAGES; i++)
+      Boot_us[i] = 0;
+   Boot_xtalOk = 0;
+   BootHi = 0;
+
+   TBCTL = TBSSEL_2 + ID_3 + MC_2 + TBCLR;   /* SMCLK / 8, continuous, no interrupt */
+   P2OUT ^= BOOT_PIN;
+}
+
+/**
+ *  @fn BootTicks
+ *  @brief The function reads the boot stopwatch
+ *
+ *  The interrupts are still disabled, the overflow is counted here, so the
+ *  stopwatch must be read at least once per overflow (655 ms).
+ *
+ *  @param none
+ *  @return ticks from BootStart
+ */
+static unsigned long BootTicks(void)
+{
+   unsigned short lo = TBR;
+
+   if(TBCTL & TBIFG)
+   {
+      TBCTL &= ~TBIFG;
+      BootHi++;
+      lo = TBR;
+   }
+   return ((unsigned long)BootHi << 16) | lo;
+}
+
+/**
+ *  @fn BootMark
+ *  @brief The function timestamps a boot stage
+ *
+ *  Only the first call of a stage counts. The stages up to BOOT_TIMER
+ *  toggle the debug pin.
+ *
+ *  @param stage  BOOT_xxx
+ *  @return none
+ */
+void BootMark(unsigned char stage)
+{
+   unsigned long ta;
+
+   if(Boot_us[stage])
+      return;
+
+   if(stage < BOOT_TIMER)
+      Boot_us[stage] = BootTicks() * BOOT_TICK_US;
+   else
+   {
+      /* us = ticks * 15625 / 512, in two parts to stay in 32 bit */
+      ta = RpmTime();
+      Boot_us[stage] = Boot_us[BOOT_XTAL] + (ta >> 9) * 15625 +
+                       (((ta & 511) * 15625) >> 9);
+   }
+
+   if(stage <= BOOT_TIMER)
+      P2OUT ^= BOOT_PIN;
+}
+
+/**
+ *  @fn BootXtal
+ *  @brief The function waits for the 32kHz crystal
+ *
+ *  The wait ends on the oscillator fault flag, or BOOT_XTAL_MAX after
+ *  FreqStart if the crystal does not start (ACLK is then not reliable).
+ *
+ *  @param none
+ *  @return 1 if the crystal is stable
+ */
+unsigned char BootXtal(void)
+{
+   while(!FreqStable())
+   {
+      if(BootTicks() >= BOOT_XTAL_MAX)
+         return 0;
+   }
+   Boot_xtalOk = 1;
+   return 1;
+}
+
+/*
+ *  This code is documented using DoxyGen
+ *  (http://www.stack.nl/~dimitri/doxygen/index.html)
+ */
@@ -0,0 +1,39 @@
+/**
+ *  @file boot.h
+ *  @author TheFwGuy
+ *  @version 1.0
+ *  @date October 2026
+ *  @brief Header file for the boot.c
+ */
+#ifndef __BOOT_H
+#define __BOOT_H
+
+/* definitions */
+
+#define BOOT_PIN        BIT_3    /* P2.3 debug pin, toggled at every stage */
+
+// STOPWATCH : Timer B on SMCLK / 8 until the time base runs
+#define BOOT_DCO_HZ     800000UL /* Nominal DCO set by FreqStart */
+#define BOOT_TICK_US    (8000000UL / BOOT_DCO_HZ)
+#define BOOT_XTAL_MAX   (1000000UL / BOOT_TICK_US)   /* Crystal start limit, 1 s */
+
+// STAGES (time from the end of FreqStart)
+#define BOOT_PARAM      0        /* Saved settings loaded */
+#define BOOT_LCD        1        /* Display reset, set up and cleared */
+#define BOOT_PERIPH     2        /* Telemetry, flash log and joystick ready */
+#define BOOT_XTAL       3        /* 32 kHz crystal stable */
+#define BOOT_TIMER      4        /* Time base running, interrupts enabled */
+#define BOOT_READING    5        /* First valid reading in Measure */
+#define BOOT_STAGES     6
+
+/*
+ *  Function prototypes
+ */
+void BootStart(void);
+void BootMark(unsigned char stage);
+unsigned char BootXtal(void);
+
+extern unsigned long Boot_us[BOOT_STAGES];
+extern unsigned char Boot_xtalOk;
+
+#endif
@@ -0,0 +1,115 @@
+/**
+ *  @file calib.c
+ *  @author TheFwGuy
+ *  @version 1.0
+ *  @date October 2026
+ *  @brief Magnet spacing calibration screen
+ *
+ *  The rotor must turn at a steady speed. The calibration runs in the
+ *  period mode whatever the mode set, for CAL_REVS revolutions (see
+ *  RpmCalStart in rpm.c), and the table is then used by the period mode
+ *  for the same number of magnets. The spread shown is the difference
+ *  between the longest and the shortest magnet interval, in % of the even
+ *  spacing.
+ */
+
+#include "system.h"
+#include "lcd_new.h"
+#include "rpm.h"
+#include "keys.h"
+#include "calib.h"
+#include "hal.h"
+
+extern unsigned char NumMagnets; /* Number of magnets */
+extern unsigned char MeasMode;   /* Measurement mode */
+extern unsigned short MagnetCal[MAX_MAGNETS]; /* Magnet spacing weights */
+
+/**
+ *  @fn Calibrate
+ *  @brief The function learns the magnet spacing table
+ *
+ *  The joystick press stops the calibration, the table is then unchanged,
+ *  as after a stop or with a magnet interval out of range.
+ *
+ *  @param none
+ *  @return none
+ */
+void Calibrate(void)
+{
+   /*
+    *  Max length
+    * "12345678901234"
+    */
+   unsigned char mode = MeasMode;
+   unsigned short lo, hi;
+   unsigned char k;
+
+   LCDClear();
+   if(NumMagnets < 2)
+   {
+      LCDStr ( 0, (unsigned char *)" Calibration" );
+      LCDStr ( 2, (unsigned char *)" One magnet," );
+      LCDStr ( 3, (unsigned char *)" nothing to do" );
+      LCDUpdate();
+      while(KeyGet() != (KEY_ID_PUSH | KEY_EV_PRESS))
+         SysSleep(MODE_LPM3);
+      return;
+   }
+
+   LCDStr ( 0, (unsigned char *)" Calibrating" );
+   LCDStr ( 1, (unsigned char *)" Steady speed" );
+   LCDStr ( 3, (unsigned char *)" Revs :" );
+   LCDStr ( 5, (unsigned char *)" Press to stop" );
+   LCDUpdate();
+
+   MeasMode = MEAS_PERIOD;
+   InitTimer();
+   RpmStart();
+   RpmCalStart();
+
+   while(Rpm_calRevs < CAL_REVS)
+   {
+      if(KeyGet() == (KEY_ID_PUSH | KEY_EV_PRESS))
+         break;
+      if(!LCDBusy())
+      {
+         LCDNum ( 7, 3, Rpm_calRevs, 3, 0 );
+         LCDUpdate();
+      }
+      // Woken by every reading, the bin tick or a key
+      SysSleep(MODE_LPM3);
+   }
+
+   LCDClear();
+   if(RpmCalEnd())
+   {
+      lo = hi = MagnetCal[0];
+      for(k = 1; k < NumMagnets; k++)
+      {
+         if(MagnetCal[k] < lo)
+            lo = MagnetCal[k];
+         if(MagnetCal[k] > hi)
+            hi = MagnetCal[k];
+      }
+      LCDStr ( 0, (unsigned char *)" Calibrated" );
+      LCDStr ( 2, (unsigned char *)" Spread %:" );
+      LCDNum ( 10, 2, ((unsigned long)(hi - lo) * 1000 + CAL_ONE / 2) / CAL_ONE, 4, 1 );
+   }
+   else
+   {
+      LCDStr ( 0, (unsigned char *)" Not done" );
+      LCDStr ( 2, (unsigned char *)" Table kept" );
+   }
+   LCDUpdate();
+
+   MeasMode = mode;
+   InitTimer();
+
+   while(KeyGet() != (KEY_ID_PUSH | KEY_EV_PRESS))
+      SysSleep(MODE_LPM3);
+}
+
+/*
+ *  This code is documented using DoxyGen
+ *  (http://www.stack.nl/~dimitri/doxygen/index.html)
+ */
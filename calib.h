@@ -0,0 +1,16 @@
+/**
+ *  @file calib.h
+ *  @author TheFwGuy
+ *  @version 1.0
+ *  @date October 2026
+ *  @brief Header file for the calib.c
+ */
+#ifndef __CALIB_H
+#define __CALIB_H
+
+/*
+ *  Function prototypes
+ */
+void Calibrate(void);
+
+#endif
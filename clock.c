@@ -0,0 +1,97 @@
+/**
+ *  @file clock.c
+ *  @author TheFwGuy
+ *  @version 1.0
+ *  @date October 2026
+ *  @brief Clock profiles of the DCO
+ *
+ *  The DCO (MCLK and SMCLK) runs at CLK_NORMAL during the boot, for the
+ *  boot stopwatch (boot.c), then main sets CLK_MAIN once for good. The
+ *  supply current of the MSP430F1xx grows with the clock in active mode
+ *  and in LPM0, and the DCO is off in LPM3 anyway, so a slower clock only
+ *  makes the same work last longer : on the display loop the bench finds
+ *  CLK_FAST for both the lowest latency and the lowest energy, and a slower
+ *  clock while asleep would not save anything (make bench, clock profiles).
+ *
+ *  What depends on SMCLK is set again with the profile : the USART0 divider
+ *  (LCD serial clock) and the flash timing generator divider, read by
+ *  flash.c. Timer_A, the WDT and the USART1 run on ACLK, Timer_B counts the
+ *  Hall edges, they do not depend on the profile.
+ */
+
+#include "system.h"
+#include "clock.h"
+#include "hal.h"
+
+/*
+ *  Profile table, with the dividers computed by the compiler :
+ *    USART0 : the fastest serial clock up to CLK_SPI_MAX, SMCLK / 2 at least
+ *    flash  : the divider (FN + 1) closest to the middle of 257-476 kHz
+ */
+typedef struct
+{
+   unsigned char dcoctl;
+   unsigned char rsel;
+   unsigned char spiBr;          /* U0BR0 */
+   unsigned char ftgDiv;         /* FCTL2 FNx */
+} ClockProfile;
+
+#define CLK_SPI_BR(hz)  ((hz) > 2 * CLK_SPI_MAX ? ((hz) + CLK_SPI_MAX - 1) / CLK_SPI_MAX : 2)
+#define CLK_FTG_FN(hz)  (((hz) + CLK_FTG_MID / 2) / CLK_FTG_MID - 1)
+#define CLK_PROFILE(dco, rsel, hz)  { (dco) << 5, rsel, CLK_SPI_BR(hz), CLK_FTG_FN(hz) }
+
+static const ClockProfile ClockTable[CLK_PROFILES] =
+{
+   CLK_PROFILE(3, 5,  312000UL),   /* CLK_SLOW */
+   CLK_PROFILE(3, 7,  800000UL),   /* CLK_NORMAL */
+   CLK_PROFILE(7, 7, 1259000UL),   /* CLK_FAST */
+};
+
+unsigned char Clock_now = CLK_NORMAL;    /* Profile in use */
+
+/**
+ *  @fn ClockSet
+ *  @brief The function switches the DCO to a profile
+ *
+ *  Nothing is changed while the LCD is being updated, the serial clock must
+ *  not change in the middle of it : the caller waits for the LCD first.
+ *
+ *  @param profile  CLK_xxx
+ *  @return none
+ */
+void ClockSet(unsigned char profile)
+{
+   const ClockProfile *p = &ClockTable[profile];
+
+   if(profile == Clock_now || (IE1 & UTXIE0))
+      return;
+
+   DCOCTL  = p->dcoctl;
+   BCSCTL1 = (BCSCTL1 & ~0x07) | p->rsel;   /* RSELx */
+
+   if(U0BR0 != p->spiBr)
+   {
+      U0CTL |= SWRST;                       /* Divider changed in reset only */
+      U0BR0  = p->spiBr;
+      U0CTL &= ~SWRST;
+   }
+
+   Clock_now = profile;
+}
+
+/**
+ *  @fn ClockFlashDiv
+ *  @brief The function gives the flash timing generator divider
+ *
+ *  @param none
+ *  @return FCTL2 FNx bits for SMCLK in the present profile
+ */
+unsigned char ClockFlashDiv(void)
+{
+   return ClockTable[Clock_now].ftgDiv;
+}
+
+/*
+ *  This code is documented using DoxyGen
+ *  (http://www.stack.nl/~dimitri/doxygen/index.html)
+ */
@@ -0,0 +1,31 @@
+/**
+ *  @file clock.h
+ *  @author TheFwGuy
+ *  @version 1.0
+ *  @date October 2026
+ *  @brief Header file for the clock.c
+ */
+#ifndef __CLOCK_H
+#define __CLOCK_H
+
+/* definitions */
+
+// PROFILES (DCO for MCLK and SMCLK)
+#define CLK_SLOW        0        /* RSEL=5 DCO=3, ~310 kHz */
+#define CLK_NORMAL      1        /* RSEL=7 DCO=3, ~800 kHz, as set by FreqStart */
+#define CLK_FAST        2        /* RSEL=7 DCO=7, ~1.25 MHz */
+#define CLK_PROFILES    3
+#define CLK_MAIN        CLK_FAST /* Set after the boot, lowest energy (make bench) */
+
+#define CLK_SPI_MAX     4000000UL   /* PCD8544 serial clock limit */
+#define CLK_FTG_MID     366000UL    /* Middle of the flash timing generator range */
+
+/*
+ *  Function prototypes
+ */
+void ClockSet(unsigned char profile);
+unsigned char ClockFlashDiv(void);
+
+extern unsigned char Clock_now;
+
+#endif
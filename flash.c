@@ -0,0 +1,86 @@
+/**
+ *  @file flash.c
+ *  @author TheFwGuy
+ *  @version 1.0
+ *  @date October 2026
+ *  @brief Flash memory erase and programming
+ *
+ *  The code runs from the flash itself, so the CPU is held by the flash
+ *  controller for every byte program (35 timing generator cycles, 88 us)
+ *  and every segment erase (4819 cycles, 12 ms). The interrupts requested
+ *  meanwhile are served when the operation ends, the timer captures are
+ *  latched by the hardware. The timing generator runs from SMCLK, with the
+ *  divider of the clock profile in use (clock.c), inside the 257-476 kHz
+ *  range.
+ *  The memory is read with FLASH8().
+ */
+
+#include "system.h"
+#include "flash.h"
+#include "clock.h"
+#include "hal.h"
+
+/**
+ *  @fn FlashUnlock
+ *  @brief The function sets the timing generator and unlocks the flash
+ *
+ *  @param mode   FCTL1 operation (WRT or ERASE)
+ *  @return none
+ */
+static void FlashUnlock(unsigned short mode)
+{
+   while(FCTL3 & BUSY)
+      ;
+   FCTL2 = FWKEY + FSSEL_2 + ClockFlashDiv();   // SMCLK / (FN + 1)
+   FCTL3 = FWKEY;                   // Clear LOCK
+   FCTL1 = FWKEY + mode;
+}
+
+/**
+ *  @fn FlashLock
+ *  @brief The function ends the operation and locks the flash
+ *
+ *  @param none
+ *  @return none
+ */
+static void FlashLock(void)
+{
+   FCTL1 = FWKEY;
+   FCTL3 = FWKEY + LOCK;
+}
+
+/**
+ *  @fn FlashErase
+ *  @brief The function erases a segment (all bytes to 0xFF)
+ *
+ *  @param addr   any address in the segment
+ *  @return none
+ */
+void FlashErase(unsigned int addr)
+{
+   FlashUnlock(ERASE);
+   FLASH8(addr) = 0;                // Dummy write starts the erase
+   FlashLock();
+}
+
+/**
+ *  @fn FlashWrite
+ *  @brief The function programs bytes in an erased area
+ *
+ *  @param addr   first address
+ *  @param buf    bytes to program
+ *  @param len    number of bytes
+ *  @return none
+ */
+void FlashWrite(unsigned int addr, const unsigned char *buf, unsigned int len)
+{
+   FlashUnlock(WRT);
+   while(len--)
+      FLASH8(addr++) = *buf++;
+   FlashLock();
+}
+
+/*
+ *  This code is documented using DoxyGen
+ *  (http://www.stack.nl/~dimitri/doxygen/index.html)
+ */
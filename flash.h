@@ -0,0 +1,22 @@
+/**
+ *  @file flash.h
+ *  @author TheFwGuy
+ *  @version 1.0
+ *  @date October 2026
+ *  @brief Header file for the flash.c
+ */
+#ifndef __FLASH_H
+#define __FLASH_H
+
+/* definitions */
+
+#define FLASH_SEG       512      /* Main memory segment, bytes */
+#define FLASH_INFO_SEG  128      /* Information memory segment, bytes */
+
+/*
+ *  Function prototypes
+ */
+void FlashErase(unsigned int addr);
+void FlashWrite(unsigned int addr, const unsigned char *buf, unsigned int len);
+
+#endif
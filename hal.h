@@ -0,0 +1,27 @@
+/**
+ *  @file hal.h
+ *  @author TheFwGuy
+ *  @version 1.0
+ *  @date October 2026
+ *  @brief Hardware access layer
+ *
+ *  The firmware uses the MSP430 register names and the mspgcc intrinsics
+ *  (interrupt(), eint(), _BIS_SR(), ...) through this header only.
+ *  On the board they come from the mspgcc headers, in the host build
+ *  (HOST_SIM defined) from the simulator in the host directory.
+ *  The flash memory is read and written through FLASH8(), so the simulator
+ *  can apply the flash controller rules.
+ */
+#ifndef __HAL_H
+#define __HAL_H
+
+#ifdef HOST_SIM
+#include "msp430_sim.h"
+#else
+#include <io.h>
+#include <signal.h>
+
+#define FLASH8(addr)  (*(volatile unsigned char *)(addr))
+#endif
+
+#endif
@@ -0,0 +1,1256 @@
+/**
+ *  @file bench.c
+ *  @author TheFwGuy
+ *  @version 1.0
+ *  @date October 2026
+ *  @brief Hall pulse-train replay benchmark for the acquisition code
+ *
+ *  The acquisition module (rpm.c, system.c) runs on the simulator and is fed
+ *  with synthetic Hall pulse trains:
+ *    constant  steady speed
+ *    step      speed step after the first readings
+ *    ramp      linear deceleration over RAMP_TIME seconds
+ *    jitter    steady speed, every pulse moved by up to +-JITTER of a period
+ *    missing   steady speed, a pulse is lost with probability MISSING
+ *    bounce    steady speed, BOUNCE extra transitions after each rising edge
+ *    stop      steady speed, then the rotor stops (t_ok is the time to a
+ *              zero reading)
+ *
+ *  Every train is run in each measurement mode for NumMagnets 1-8 and
+ *  AcqSecTime 1-10 s (the auto mode only once, it has no gate setting).
+ *  For each case the bench reports:
+ *    err     RPM error of the steady state readings (% of the true speed)
+ *    t_ok    time from the last speed change to the first reading within
+ *            TOLERANCE of the true speed
+ *    isr/s   interrupt service routines executed per second
+ *
+ *  A slow rotor (SLOW_RPM, edges further apart than RPM_STALL_MAX) must
+ *  still be read in the gate modes with the longest window, with no stall.
+ *
+ *  Then the speed trip output is checked in the edge interrupt modes, with
+ *  a speed step above an overspeed limit and a ramp below an underspeed
+ *  limit. The bench reports the time from the crossing to the output and
+ *  to the first reading past the limit, the time from the Hall edge that
+ *  revealed the crossing to the output, and the trips outside the
+ *  crossing.
+ *
+ *  Last the magnet spacing calibration is checked in the period mode, on a
+ *  rotor with magnets up to SPACING of their spacing away from the even
+ *  position : the table is learned on a steady train, then a speed step is
+ *  measured with full revolutions (no table), with single intervals and an
+ *  even table (flat), and with single intervals and the learned table.
+ *
+ *  And the flash log (log.c) is filled past its end with typical series of
+ *  readings, then read back with the host decoder (logread.c) : the samples
+ *  decoded must be the last ones logged, bit for bit, each in its run (a
+ *  run whose first record was overwritten is run 0). The bench reports the
+ *  bytes per sample, the samples per KB of the log area and the history it
+ *  holds at the rate of the series, then the erases of every segment over
+ *  several boots, one run each (wear leveling), and the flash programming
+ *  errors.
+ *
+ *  At the end the clock profiles (clock.c) are compared on the display loop
+ *  of the Measure screen, in gate mode with a reading every bin : the time
+ *  to send a full LCD frame, the time from a reading to the end of its
+ *  display update, the CPU active time and the energy from the supply
+ *  currents of the simulator. The simulator charges the register accesses
+ *  only, the formatting code is not included (see fmtbench).
+ *
+ *  Every section checks its results against limits (Train.err_lim, the
+ *  XXX_MAX defines) and ends with its check line, the failed checks are
+ *  printed as they are found and the bench exits with 1 if any failed.
+ *
+ *  Usage: bench [-c] [-r bins] [-f filter] [section ...]
+ *    -c         prints every case in CSV format instead of the summary
+ *               (acquisition only, the failed checks go to stderr)
+ *    -r bins    RefreshBins of the counting modes (default 1, every 125 ms)
+ *    -f filter  glitch filter: off, fixed (default) or auto
+ *    section    acq, slow, trip, cal, log or clock (default all of them)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include "system.h"
+#include "rpm.h"
+#include "log.h"
+#include "clock.h"
+#include "lcd_new.h"
+#include "hal.h"
+#include "sim.h"
+#include "logread.h"
+
+#define TOLERANCE   1.0         /* % of the true speed for a correct reading */
+#define RAMP_TIME   2.0         /* s */
+#define JITTER      0.05        /* fraction of the edge period */
+#define MISSING     0.02        /* probability of a lost pulse */
+#define BOUNCE      2           /* extra pulses per edge */
+#define BOUNCE_TIME 20e-6       /* s between bounce transitions */
+#define DUTY        0.25        /* Hall pulse width, fraction of the edge period */
+#define SPACING     0.05        /* largest magnet offset, fraction of the spacing */
+
+/* Limits of the checks */
+#define TRIP_MAX        0.1     /* s from the crossing to the trip output */
+#define TRIP_EDGE_MAX   250e-6  /* s from the Hall edge to the trip output */
+#define CAL_AVG_MAX     0.5     /* % steady error with the learned table */
+#define CAL_ERR_MAX     1.5     /* % worst error with the learned table */
+#define LOG_WEAR_MAX    1       /* erases between the most and least worn segment */
+
+#define MAX_GATE    10
+#define MAX_RISE    16          /* rising edges kept for the trip latency */
+#define MAX_QUEUE   (2 * BOUNCE + 2)
+
+enum { PROF_CONST, PROF_STEP, PROF_RAMP, PROF_STOP };
+
+typedef struct
+{
+   const char *name;
+   int    profile;
+   double rpm0;         /* speed at start */
+   double rpm1;         /* speed after the change */
+   double jitter;
+   double missing;
+   int    bounce;
+   double spacing;      /* magnet offset scale, see Offset[] */
+   double err_lim;      /* largest err avg % of a mode */
+   double never_lim;    /* largest fraction of the cases never correct */
+} Train;
+
+/*
+ *  The missing pulses take 2% off the counts, more than TOLERANCE : a
+ *  counting mode case is only correct by chance, only the error is checked.
+ */
+static const Train Trains[] =
+{
+   { "constant", PROF_CONST, 1234.0, 1234.0, 0.0,    0.0,     0,      0.0, 0.5, 0.05 },
+   { "step",     PROF_STEP,  1234.0, 2345.0, 0.0,    0.0,     0,      0.0, 0.5, 0.05 },
+   { "ramp",     PROF_RAMP,  2345.0,  600.0, 0.0,    0.0,     0,      0.0, 0.5, 0.05 },
+   { "jitter",   PROF_CONST, 1234.0, 1234.0, JITTER, 0.0,     0,      0.0, 2.0, 0.05 },
+   { "missing",  PROF_CONST, 1234.0, 1234.0, 0.0,    MISSING, 0,      0.0, 3.0, 1.0  },
+   { "bounce",   PROF_CONST, 1234.0, 1234.0, 0.0,    0.0,     BOUNCE, 0.0, 0.5, 0.05 },
+   { "stop",     PROF_STOP,  1234.0,    0.0, 0.0,    0.0,     0,      0.0, 0.5, 0.05 },
+};
+
+#define NUM_TRAINS   (sizeof(Trains) / sizeof(Trains[0]))
+
+static const char *ModeName[MEAS_NUM] = { "gate", "period", "hwcount", "auto" };
+
+typedef struct
+{
+   double err_avg;      /* % */
+   double err_max;      /* % */
+   double t_ok;         /* s, negative if never correct */
+   double isr_rate;     /* 1/s */
+   double upd_rate;     /* readings per second */
+} Result;
+
+/* Magnet offsets, fraction of the spacing (times Train.spacing) */
+static const double Offset[MAX_MAGNETS] = { 0.0, 0.6, -0.4, 1.0, -0.8, 0.3, -1.0, 0.5 };
+
+/* Firmware configuration, normally owned by main.c */
+unsigned char NumMagnets;
+unsigned char AcqSecTime;
+unsigned char MeasMode;
+unsigned char RefreshBins;
+unsigned char GlitchMode;
+unsigned char TripMode;
+unsigned short TripRpm;
+unsigned short MagnetCal[MAX_MAGNETS];
+unsigned char CalMagnets;
+
+static unsigned char Refresh = 1;
+static unsigned char CalLearn;      /* Calibration during the case */
+static unsigned char Filter  = FILTER_FIXED;
+static const char   *FilterName[FILTER_NUM] = { "off", "fixed", "auto" };
+static int           Csv;           /* Acquisition cases in CSV */
+
+/*
+ *  Checks, the failures are printed with the results (on stderr in CSV)
+ */
+static int Check(int ok, const char *fmt, ...)
+{
+   FILE  *out = Csv ? stderr : stdout;
+   va_list ap;
+
+   if(ok)
+      return 0;
+   fprintf(out, "FAIL: ");
+   va_start(ap, fmt);
+   vfprintf(out, fmt, ap);
+   va_end(ap);
+   fprintf(out, "\n");
+   return 1;
+}
+
+static void CheckEnd(const char *section, int fails)
+{
+   if(!Csv)
+      printf("%s check: %s\n", section, fails ? "FAILED" : "ok");
+}
+
+/*
+ *  Pulse train generator
+ */
+static const Train *Tr;
+static double T0;             /* simulator time of the train start */
+static double Tchange;        /* train time of the speed change */
+static double Tsettle;        /* train time the final speed is reached */
+static unsigned long Pulse;   /* next pulse number */
+static double LastT;
+static double Queue[MAX_QUEUE];
+static int    QueueLevel[MAX_QUEUE];
+static int    QueueHead, QueueLen;
+static unsigned long Seed;
+static double Rise[MAX_RISE]; /* train time of the last rising edges */
+static unsigned int RiseIdx;
+
+static double Rand(void)
+{
+   Seed = Seed * 1103515245UL + 12345UL;
+   return (double)((Seed >> 16) & 0x7FFF) / 32768.0;
+}
+
+static double Speed(double t)
+{
+   switch(Tr->profile)
+   {
+      case PROF_STEP:
+      case PROF_STOP:
+         return t < Tchange ? Tr->rpm0 : Tr->rpm1;
+
+      case PROF_RAMP:
+         if(t < Tchange)
+            return Tr->rpm0;
+         if(t < Tsettle)
+            return Tr->rpm0 + (Tr->rpm1 - Tr->rpm0) * (t - Tchange) / RAMP_TIME;
+         return Tr->rpm1;
+
+      default:
+         return Tr->rpm0;
+   }
+}
+
+/* Revolutions done at time t */
+static double Angle(double t)
+{
+   double u;
+
+   switch(Tr->profile)
+   {
+      case PROF_STEP:
+         if(t < Tchange)
+            return Tr->rpm0 * t / 60.0;
+         return (Tr->rpm0 * Tchange + Tr->rpm1 * (t - Tchange)) / 60.0;
+
+      case PROF_STOP:
+         return Tr->rpm0 * (t < Tchange ? t : Tchange) / 60.0;
+
+      case PROF_RAMP:
+         if(t < Tchange)
+            return Tr->rpm0 * t / 60.0;
+         u = (t < Tsettle ? t : Tsettle) - Tchange;
+         u = Tr->rpm0 * Tchange + Tr->rpm0 * u
+           + 0.5 * (Tr->rpm1 - Tr->rpm0) * u * u / RAMP_TIME;
+         if(t > Tsettle)
+            u += Tr->rpm1 * (t - Tsettle);
+         return u / 60.0;
+
+      default:
+         return Tr->rpm0 * t / 60.0;
+   }
+}
+
+/* Time of the n-th magnet pulse */
+static double PulseTime(unsigned long n)
+{
+   double target = (n + Tr->spacing * Offset[n % NumMagnets]) / NumMagnets;
+   double lo = LastT > 0.0 ? LastT : 0.0;
+   double hi = lo + 1e-3;
+   int    i;
+
+   while(Angle(hi) < target)
+      hi += hi - lo;
+
+   for(i = 0; i < 60; i++)
+   {
+      double mid = (lo + hi) / 2.0;
+
+      if(Angle(mid) < target)
+         lo = mid;
+      else
+         hi = mid;
+   }
+   return hi;
+}
+
+static void Push(double t, int level)
+{
+   int i = (QueueHead + QueueLen++) % MAX_QUEUE;
+
+   Queue[i]      = t;
+   QueueLevel[i] = level;
+   if(level)
+      Rise[RiseIdx++ % MAX_RISE] = t;
+}
+
+static double HallTrain(void *ctx, int *level)
+{
+   double t, period;
+   int    i;
+
+   (void)ctx;
+   while(QueueLen == 0)
+   {
+      /* No more pulses once the rotor has stopped */
+      if(Tr->profile == PROF_STOP && (double)(Pulse + 1) / NumMagnets > Angle(Tchange))
+         return 1e30;
+
+      t      = PulseTime(++Pulse);
+      period = 60.0 / (Speed(t) * NumMagnets);
+      LastT  = t;
+
+      if(Tr->missing > 0.0 && Rand() < Tr->missing)
+         continue;
+
+      t += Tr->jitter * period * (2.0 * Rand() - 1.0);
+      Push(t, 1);
+      for(i = 0; i < Tr->bounce; i++)
+      {
+         Push(t + (2 * i + 1) * BOUNCE_TIME, 0);
+         Push(t + (2 * i + 2) * BOUNCE_TIME, 1);
+      }
+      Push(t + DUTY * period, 0);
+   }
+
+   t      = Queue[QueueHead];
+   *level = QueueLevel[QueueHead];
+   QueueHead = (QueueHead + 1) % MAX_QUEUE;
+   QueueLen--;
+   return T0 + t;
+}
+
+/*
+ *  Reading collection, done as the display loop would do after every
+ *  interrupt that published a reading. The raw values are only stored here
+ *  and converted after the run, because the conversion may touch the
+ *  interrupt state and the multiplier.
+ */
+#define MAX_SAMPLES  (1UL << 17)
+
+static double        SampleT[MAX_SAMPLES];
+static unsigned long SampleVal[MAX_SAMPLES];
+static unsigned char SampleEdges[MAX_SAMPLES];
+static unsigned long Samples;
+static unsigned char Seq;
+
+/* Speed trip output changes */
+static unsigned char TripLast;
+static double        TripT;        /* first trip after the speed change */
+static double        TripEdge;     /* from the last rising edge to the trip */
+static int           TripFalse;    /* trips before the speed change */
+
+static void Trip(void)
+{
+   double t = sim_time() - T0;
+   double edge = 0.0;
+   unsigned int i;
+
+   if(Rpm_trip == TripLast)
+      return;
+   TripLast = Rpm_trip;
+   if(!TripLast)
+      return;
+
+   if(t < Tchange)
+   {
+      TripFalse++;
+      return;
+   }
+   if(TripT >= 0.0)
+      return;
+
+   for(i = 0; i < MAX_RISE; i++)
+      if(Rise[i] <= t && Rise[i] > edge)
+         edge = Rise[i];
+   TripT    = t;
+   TripEdge = t - edge;
+}
+
+static void Reading(int vector)
+{
+   RpmSnap snap;
+
+   (void)vector;
+   Trip();
+   if(Samples >= MAX_SAMPLES || !RpmRead(&snap, &Seq))
+      return;
+
+   SampleT[Samples] = sim_time() - T0;
+   if(MeasMode == MEAS_PERIOD || MeasMode == MEAS_AUTO)
+   {
+      SampleVal[Samples]   = snap.gate;
+      SampleEdges[Samples] = (unsigned char)snap.count;
+   }
+   else
+      SampleVal[Samples] = snap.count;
+   Samples++;
+}
+
+static void Evaluate(double window, Result *r)
+{
+   double rpm, truth, err, t;
+   double err_sum = 0.0, err_max = 0.0, t_ok = -1.0;
+   unsigned long i, num = 0;
+
+   for(i = 0; i < Samples; i++)
+   {
+      if(MeasMode == MEAS_PERIOD || MeasMode == MEAS_AUTO)
+         rpm = RpmTicksTenths(SampleVal[i], SampleEdges[i]) / 10.0;
+      else
+         rpm = RpmGateTenths(SampleVal[i]) / 10.0;
+
+      t     = SampleT[i];
+      truth = Speed(t);
+      if(truth > 0.0)
+         err = fabs(rpm - truth) * 100.0 / truth;
+      else
+         err = rpm > 0.0 ? 100.0 : 0.0;
+
+      if(t_ok < 0.0 && t >= Tsettle && err <= TOLERANCE)
+         t_ok = t - Tsettle;
+
+      if(t >= window)
+      {
+         err_sum += err;
+         num++;
+         if(err > err_max)
+            err_max = err;
+      }
+   }
+
+   r->err_avg = num ? err_sum / num : NAN;
+   r->err_max = num ? err_max : NAN;
+   r->t_ok    = t_ok;
+}
+
+static void RunCase(const Train *train, int mode, int magnets, int gate, Result *r)
+{
+   double end;
+   unsigned long isr;
+   int    v;
+
+   sim_reset();
+   NumMagnets = magnets;
+   AcqSecTime = gate;
+   MeasMode   = mode;
+   RefreshBins = Refresh;
+   GlitchMode  = Filter;
+
+   InitPeriph();
+   InitFreq();
+   InitTimer();
+   RpmStart();
+   if(CalLearn)
+      RpmCalStart();
+
+   Tr      = train;
+   T0      = sim_time();
+   Tchange = train->profile == PROF_CONST ? 0.0 : 2.0 * gate + 1.0;
+   Tsettle = Tchange + (train->profile == PROF_RAMP ? RAMP_TIME : 0.0);
+   end     = Tsettle + 3.0 * gate + 1.5;
+
+   Pulse = 0;
+   LastT = 0.0;
+   QueueHead = QueueLen = 0;
+   Seed = 1 + magnets * 131 + gate * 17;
+
+   Samples = 0;
+   Seq     = Rpm_seq;
+
+   memset(Rise, 0, sizeof(Rise));
+   RiseIdx   = 0;
+   TripLast  = Rpm_trip;
+   TripT     = -1.0;
+   TripEdge  = 0.0;
+   TripFalse = 0;
+
+   sim_set_isr_hook(Reading);
+   sim_set_hall(HallTrain, NULL);
+   eint();
+   sim_run_until(T0 + end);
+   sim_set_isr_hook(NULL);
+
+   isr = 0;
+   for(v = 0; v < SIM_NUM_VECTORS; v++)
+      isr += sim_isr_count(v * 2);
+
+   Evaluate(Tsettle + gate + 0.5, r);
+   r->isr_rate = isr / end;
+   r->upd_rate = Samples / end;
+}
+
+/*
+ *  Speed trip latency, in the modes with an edge interrupt
+ */
+typedef struct
+{
+   const char *name;
+   int    mode;         /* TRIP_OVER or TRIP_UNDER */
+   unsigned short limit;
+   const Train *train;
+} TripCase;
+
+static const Train TripStep = { "step", PROF_STEP, 1234.0, 2345.0, 0.0, 0.0, 0, 0.0 };
+static const Train TripRamp = { "ramp", PROF_RAMP, 2345.0,  600.0, 0.0, 0.0, 0, 0.0 };
+
+static const TripCase TripCases[] =
+{
+   { "over",  TRIP_OVER,  2000, &TripStep },
+   { "under", TRIP_UNDER, 1000, &TripRamp },
+};
+
+#define NUM_TRIP_CASES   (sizeof(TripCases) / sizeof(TripCases[0]))
+
+/* First reading past the limit after t, -1 if none */
+static double ReadingPast(const TripCase *c, double t)
+{
+   unsigned long i;
+   double rpm;
+
+   for(i = 0; i < Samples; i++)
+   {
+      if(SampleT[i] < t)
+         continue;
+      if(MeasMode == MEAS_PERIOD || MeasMode == MEAS_AUTO)
+         rpm = RpmTicksTenths(SampleVal[i], SampleEdges[i]) / 10.0;
+      else
+         rpm = RpmGateTenths(SampleVal[i]) / 10.0;
+      if(c->mode == TRIP_OVER ? rpm > c->limit : rpm < c->limit)
+         return SampleT[i];
+   }
+   return -1.0;
+}
+
+static int TripBench(void)
+{
+   static const int modes[] = { MEAS_GATE, MEAS_PERIOD, MEAS_AUTO };
+   const TripCase *c;
+   unsigned int i, m;
+   int    magnets, n, never, rnever, false_trips;
+   int    fails = 0;
+   double cross, t, trip_avg, trip_max, edge_max, read_avg, read_max;
+   Result r;
+
+   printf("\nSpeed trip: over %d rpm on a %.0f-%.0f rpm step, under %d rpm on a "
+          "%.0f-%.0f rpm ramp, magnets 1-8, gate 1 s\n\n",
+          TripCases[0].limit, TripStep.rpm0, TripStep.rpm1,
+          TripCases[1].limit, TripRamp.rpm0, TripRamp.rpm1);
+   printf("%-8s %-6s %9s %9s %11s %6s %9s %9s %6s %6s\n", "mode", "trip",
+          "trip avg", "trip max", "edge-out us", "never", "read avg", "read max",
+          "never", "false");
+
+   for(m = 0; m < sizeof(modes) / sizeof(modes[0]); m++)
+   {
+      for(i = 0; i < NUM_TRIP_CASES; i++)
+      {
+         c = &TripCases[i];
+         trip_avg = trip_max = edge_max = read_avg = read_max = 0.0;
+         n = never = rnever = false_trips = 0;
+
+         for(magnets = 1; magnets <= MAX_MAGNETS; magnets++)
+         {
+            TripMode = c->mode;
+            TripRpm  = c->limit;
+            RunCase(c->train, modes[m], magnets, 1, &r);
+
+            /* Time the true speed crosses the limit */
+            cross = Tchange;
+            if(c->train->profile == PROF_RAMP)
+               cross += (c->train->rpm0 - c->limit) * RAMP_TIME /
+                        (c->train->rpm0 - c->train->rpm1);
+
+            n++;
+            false_trips += TripFalse;
+            if(TripT < 0.0)
+               never++;
+            else
+            {
+               t = TripT - cross;
+               trip_avg += t;
+               if(t > trip_max)
+                  trip_max = t;
+               if(TripEdge > edge_max)
+                  edge_max = TripEdge;
+            }
+
+            t = ReadingPast(c, cross);
+            if(t < 0.0)
+               rnever++;
+            else
+            {
+               read_avg += t - cross;
+               if(t - cross > read_max)
+                  read_max = t - cross;
+            }
+         }
+
+         printf("%-8s %-6s ", ModeName[modes[m]], c->name);
+         if(n > never)
+            printf("%9.3f %9.3f %11.1f ", trip_avg / (n - never), trip_max,
+                   edge_max * 1e6);
+         else
+            printf("%9s %9s %11s ", "-", "-", "-");
+         printf("%6d ", never);
+         if(n > rnever)
+            printf("%9.3f %9.3f ", read_avg / (n - rnever), read_max);
+         else
+            printf("%9s %9s ", "-", "-");
+         printf("%6d %6d\n", rnever, false_trips);
+
+         fails += Check(!never && !rnever, "%s %s: trip or reading never past the limit",
+                        ModeName[modes[m]], c->name);
+         fails += Check(!false_trips, "%s %s: %d trips before the crossing",
+                        ModeName[modes[m]], c->name, false_trips);
+         fails += Check(trip_max <= TRIP_MAX && edge_max <= TRIP_EDGE_MAX,
+                        "%s %s: trip %.3f s after the crossing, %.1f us after the edge",
+                        ModeName[modes[m]], c->name, trip_max, edge_max * 1e6);
+      }
+   }
+   TripMode = TRIP_OFF;
+   CheckEnd("trip", fails);
+   return fails;
+}
+
+/*
+ *  Slow rotor in the gate modes : edges further apart than RPM_STALL_MAX,
+ *  inside the window
+ */
+#define SLOW_RPM     6.0
+#define SLOW_GATE    MAX_GATE
+#define SLOW_ERR_MAX 1.0        /* % worst steady error, no stall */
+
+static const Train SlowTrain = { "slow", PROF_CONST, SLOW_RPM, SLOW_RPM, 0.0, 0.0, 0, 0.0 };
+
+static int SlowBench(void)
+{
+   static const int modes[] = { MEAS_GATE, MEAS_HWCOUNT };
+   unsigned int m;
+   int    magnets;
+   int    fails = 0;
+   Result r;
+
+   printf("\nSlow rotor: %.0f rpm, gate %d s, magnets 1-2 (an edge every %.0f-%.0f s)\n\n",
+          SLOW_RPM, SLOW_GATE, 30.0 / SLOW_RPM, 60.0 / SLOW_RPM);
+   printf("%-8s %-8s %9s %9s %9s %9s\n", "mode", "magnets", "err avg%", "err max%",
+          "t_ok", "upd/s");
+
+   for(m = 0; m < sizeof(modes) / sizeof(modes[0]); m++)
+   {
+      for(magnets = 1; magnets * SLOW_RPM < 15.0; magnets++)
+      {
+         RunCase(&SlowTrain, modes[m], magnets, SLOW_GATE, &r);
+         printf("%-8s %-8d %9.3f %9.3f ", ModeName[modes[m]], magnets, r.err_avg, r.err_max);
+         if(r.t_ok < 0.0)
+            printf("%9s", "never");
+         else
+            printf("%9.3f", r.t_ok);
+         printf(" %9.1f\n", r.upd_rate);
+
+         fails += Check(r.err_max <= SLOW_ERR_MAX && r.t_ok >= 0.0,
+                        "%s %d magnets: err max %.3f%%", ModeName[modes[m]], magnets,
+                        r.err_max);
+      }
+   }
+   CheckEnd("slow", fails);
+   return fails;
+}
+
+/*
+ *  Magnet spacing calibration, in the period mode
+ */
+static const Train CalConst = { "constant", PROF_CONST, 1234.0, 1234.0, 0.0, 0.0, 0, SPACING };
+static const Train CalStep  = { "step",     PROF_STEP,  1234.0, 2345.0, 0.0, 0.0, 0, SPACING };
+
+static int CalBench(void)
+{
+   static const char *TableName[] = { "revolution", "flat", "calibrated" };
+   unsigned short learned[MAX_MAGNETS];
+   unsigned short lo, hi;
+   int    magnets, k, table, ok;
+   int    fails = 0;
+   Result r;
+
+   printf("\nMagnet spacing: magnets up to %.0f%% of the spacing off, %.0f-%.0f rpm "
+          "step, period mode, table learned over %d revolutions\n\n",
+          SPACING * 100.0, CalStep.rpm0, CalStep.rpm1, CAL_REVS);
+   printf("%-8s %-11s %8s %9s %9s %9s %9s\n", "magnets", "table", "spread%",
+          "err avg%", "err max%", "t_ok", "upd/s");
+
+   for(magnets = 2; magnets <= MAX_MAGNETS; magnets++)
+   {
+      CalMagnets = 0;
+      CalLearn   = 1;
+      RunCase(&CalConst, MEAS_PERIOD, magnets, 1, &r);
+      CalLearn   = 0;
+      ok = RpmCalEnd();
+      memcpy(learned, MagnetCal, sizeof(learned));
+      fails += Check(ok, "%d magnets: calibration failed", magnets);
+
+      for(table = 0; table < 3; table++)
+      {
+         if(table == 0)
+            CalMagnets = 0;
+         else
+         {
+            for(k = 0; k < magnets; k++)
+               MagnetCal[k] = table == 1 ? CAL_ONE : learned[k];
+            CalMagnets = magnets;
+         }
+         if(table == 2 && !ok)
+         {
+            printf("%-8d %-11s %8s\n", magnets, TableName[table], "failed");
+            continue;
+         }
+         RunCase(&CalStep, MEAS_PERIOD, magnets, 1, &r);
+
+         lo = hi = MagnetCal[0];
+         for(k = 1; k < magnets; k++)
+         {
+            if(MagnetCal[k] < lo)
+               lo = MagnetCal[k];
+            if(MagnetCal[k] > hi)
+               hi = MagnetCal[k];
+         }
+         printf("%-8d %-11s %8.2f %9.3f %9.3f ", magnets, TableName[table],
+                CalMagnets ? (hi - lo) * 100.0 / CAL_ONE : 0.0, r.err_avg, r.err_max);
+         if(r.t_ok < 0.0)
+            printf("%9s", "never");
+         else
+            printf("%9.3f", r.t_ok);
+         printf(" %9.1f\n", r.upd_rate);
+
+         if(table == 0)
+            fails += Check(r.err_max <= TOLERANCE && r.t_ok >= 0.0,
+                           "%d magnets revolution: err max %.3f%%", magnets, r.err_max);
+         else if(table == 2)
+            fails += Check(r.err_avg <= CAL_AVG_MAX && r.err_max <= CAL_ERR_MAX && r.t_ok >= 0.0,
+                           "%d magnets calibrated: err avg %.3f%% max %.3f%%",
+                           magnets, r.err_avg, r.err_max);
+      }
+   }
+   CalMagnets = 0;
+   CheckEnd("cal", fails);
+   return fails;
+}
+
+/*
+ *  Flash log round trip
+ */
+enum { SER_STEADY, SER_GATE, SER_PERIOD, SER_RAMP, SER_RANDOM };
+
+typedef struct
+{
+   const char *name;
+   int    series;
+   double interval;     /* s between readings, 0 if irregular */
+} LogCase;
+
+static const LogCase LogCases[] =
+{
+   { "steady", SER_STEADY, 1.0   },   /* 1234.0 rpm, every second */
+   { "gate",   SER_GATE,   1.0   },   /* 1234 rpm, 2 magnets, 1 s gate (30 rpm steps) */
+   { "period", SER_PERIOD, 0.0486 },  /* every revolution at 1234 rpm, +-1 tick */
+   { "ramp",   SER_RAMP,   0.125 },   /* 3000 rpm to stop in 10 min, every bin */
+   { "random", SER_RANDOM, 0.0   },   /* any value, any interval, time going back */
+};
+
+#define NUM_LOG_CASES   (sizeof(LogCases) / sizeof(LogCases[0]))
+#define LOG_AREA        (LOG_SEGS * LOG_SEG)
+#define LOG_MAX_IN      (1UL << 16)
+#define LOG_BOOTS       4
+
+static unsigned long LogInT[LOG_MAX_IN], LogInV[LOG_MAX_IN];
+static unsigned long LogOutT[LOG_MAX_IN], LogOutV[LOG_MAX_IN];
+static int           LogOutR[LOG_MAX_IN];
+static unsigned long LogOut;
+static unsigned long LogRunAt[LOG_BOOTS];   /* First input sample of every run */
+static int           LogRuns;
+static unsigned long LogStampNow;
+static double        LogEdges;
+
+static void LogSample(void *ctx, unsigned long stamp, unsigned long rpm10, int run)
+{
+   (void)ctx;
+   if(LogOut < LOG_MAX_IN)
+   {
+      LogOutT[LogOut] = stamp;
+      LogOutV[LogOut] = rpm10;
+      LogOutR[LogOut] = run;
+   }
+   LogOut++;
+}
+
+/* Next reading of a series: time base and RPM x 10 */
+static void LogSeries(int series, unsigned long i, unsigned long *t, unsigned long *v)
+{
+   unsigned long dt, prev;
+   double rpm;
+
+   if(i == 0)
+   {
+      LogStampNow = 12345;
+      LogEdges    = 0.0;
+   }
+
+   switch(series)
+   {
+      case SER_STEADY:
+         LogStampNow += 32768;
+         *v = 12340;
+         break;
+
+      case SER_GATE:
+         prev = (unsigned long)LogEdges;
+         LogEdges += 1234.0 * 2 / 60.0;
+         LogStampNow += 32768;
+         *v = ((unsigned long)LogEdges - prev) * 300;
+         break;
+
+      case SER_PERIOD:
+         dt = 1593 + (Rand() < 0.3);
+         LogStampNow += dt;
+         *v = RPM10_TICKS / dt;
+         break;
+
+      case SER_RAMP:
+         rpm = 3000.0 * (1.0 - i * 0.125 / 600.0);
+         LogStampNow += 4096;
+         *v = rpm > 0.0 ? (unsigned long)(rpm * 10.0 + Rand() * 10.0) : 0;
+         break;
+
+      default:
+         if(Rand() < 0.05)
+            LogStampNow -= (unsigned long)(Rand() * 1e6);
+         else
+            LogStampNow += (unsigned long)(Rand() < 0.5 ? Rand() * 100.0 : Rand() * 2e9);
+         *v = ((unsigned long)(Rand() * 32768.0) << 15) | (unsigned long)(Rand() * 32768.0);
+         break;
+   }
+   LogStampNow &= 0xFFFFFFFFUL;
+   *t = LogStampNow;
+}
+
+/*
+ *  Decodes the log area, returns the samples that differ from the last ones
+ *  logged or that are not in their run. The oldest runs may have lost their
+ *  first record: a sample is in run n when n run starts are in the area up
+ *  to it. *runs gets the run starts in the area.
+ */
+static unsigned long LogCheck(unsigned long in, LogStat *st, int *runs)
+{
+   static unsigned char area[LOG_AREA];
+   unsigned long k, base, bad = 0;
+   int   r, run;
+
+   sim_flash_read(LOG_BASE, area, LOG_AREA);
+   LogOut = 0;
+   LogDecode(area, LogSample, NULL, st);
+
+   if(LogOut > in || LogOut > LOG_MAX_IN)
+      return LogOut;
+   base = in - LogOut;
+   for(k = 0; k < LogOut; k++)
+   {
+      for(run = 0, r = 0; r < LogRuns; r++)
+         run += LogRunAt[r] >= base && LogRunAt[r] <= base + k;
+      if(LogOutT[k] != LogInT[base + k] || LogOutV[k] != LogInV[base + k] ||
+         LogOutR[k] != run)
+         bad++;
+   }
+   for(*runs = 0, r = 0; r < LogRuns; r++)
+      *runs += LogRunAt[r] >= base;
+   return bad;
+}
+
+static int LogBench(void)
+{
+   unsigned long in, bad, lo, hi, e;
+   unsigned int c, boot, seg;
+   int   runs;
+   int   fails = 0;
+   LogStat st;
+
+   printf("\nFlash log: %d segments of %d bytes, records up to %d bytes, "
+          "filled past the end\n\n", LOG_SEGS, LOG_SEG, LOG_BATCH);
+   printf("%-8s %9s %9s %9s %6s %6s %9s %10s %9s\n", "series", "interval",
+          "logged", "decoded", "wrong", "bad", "B/sample", "samples/KB", "hours");
+
+   for(c = 0; c < NUM_LOG_CASES; c++)
+   {
+      sim_reset();
+      InitFreq();
+      Seed = 1;
+      LogInit();
+      LogStart();
+      LogRunAt[0] = 0;
+      LogRuns = 1;
+
+      for(in = 0; in < LOG_MAX_IN && Log_bytes < LOG_AREA + LOG_AREA / 4; in++)
+      {
+         LogSeries(LogCases[c].series, in, &LogInT[in], &LogInV[in]);
+         LogAdd(LogInT[in], LogInV[in]);
+      }
+      LogFlush();
+      bad = LogCheck(in, &st, &runs);
+
+      printf("%-8s ", LogCases[c].name);
+      if(LogCases[c].interval > 0.0)
+         printf("%9.3f ", LogCases[c].interval);
+      else
+         printf("%9s ", "-");
+      printf("%9lu %9lu %6lu %6lu %9.2f %10.0f ", in, LogOut, bad + sim_flash_errors(),
+             st.bad, st.samples ? (double)st.bytes / st.samples : 0.0,
+             st.samples * 1024.0 / LOG_AREA);
+      if(LogCases[c].interval > 0.0)
+         printf("%9.1f\n", st.samples * LogCases[c].interval / 3600.0);
+      else
+         printf("%9s\n", "-");
+
+      fails += Check(LogOut && !bad && !st.bad && !sim_flash_errors(),
+                     "%s: %lu decoded, %lu wrong, %lu bad records, %lu flash errors",
+                     LogCases[c].name, LogOut, bad, st.bad, sim_flash_errors());
+   }
+
+   /* Wear: several boots, each one logging most of the area */
+   sim_reset();
+   InitFreq();
+   Seed = 1;
+   in   = 0;
+   LogRuns = 0;
+   for(boot = 0; boot < LOG_BOOTS; boot++)
+   {
+      LogInit();
+      LogStart();
+      LogRunAt[LogRuns++] = in;
+      while(in < LOG_MAX_IN && Log_bytes < LOG_AREA - LOG_AREA / 5)
+      {
+         LogSeries(SER_GATE, in, &LogInT[in], &LogInV[in]);
+         LogAdd(LogInT[in], LogInV[in]);
+         in++;
+      }
+      LogFlush();
+   }
+   bad = LogCheck(in, &st, &runs);
+
+   lo = hi = sim_flash_erases(LOG_BASE);
+   for(seg = 1; seg < LOG_SEGS; seg++)
+   {
+      e = sim_flash_erases(LOG_BASE + seg * LOG_SEG);
+      if(e < lo)
+         lo = e;
+      if(e > hi)
+         hi = e;
+   }
+   printf("\n%d boots of %lu%% of the area: %lu samples, %d runs decoded (%d started "
+          "in the area), %lu wrong, erases per segment %lu-%lu, %lu flash errors\n",
+          LOG_BOOTS, 100UL - 100 / 5, LogOut, st.runs, runs, bad, lo, hi, sim_flash_errors());
+
+   fails += Check(LogOut && !bad && st.runs == runs && !sim_flash_errors(),
+                  "wear: %lu wrong, %d runs decoded, %d expected", bad, st.runs, runs);
+   fails += Check(hi - lo <= LOG_WEAR_MAX, "wear: erases per segment %lu-%lu", lo, hi);
+   CheckEnd("log", fails);
+   return fails;
+}
+
+/*
+ *  Clock profiles on the display loop
+ */
+#define CLK_RUN      20.0       /* s of display loop per profile */
+#define CLK_RPM      3000.0
+#define CLK_MAGNETS  4
+
+static const char  *ClockName[CLK_PROFILES] = { "slow", "800k", "fast" };
+static const double ClockKhz[CLK_PROFILES]  = { 312.0, 800.0, 1259.0 };   /* nominal DCO */
+
+static double        ClkEdge;
+static int           ClkLevel;
+static unsigned char ClkSeen;
+static double        ClkPub;       /* time of the last reading published */
+
+static double ClockWave(void *ctx, int *level)
+{
+   (void)ctx;
+   ClkEdge += 60.0 / (CLK_RPM * CLK_MAGNETS) / 2.0;
+   ClkLevel = !ClkLevel;
+   *level = ClkLevel;
+   return ClkEdge;
+}
+
+static void ClockHook(int vector)
+{
+   (void)vector;
+   if(Rpm_seq != ClkSeen)
+   {
+      ClkSeen = Rpm_seq;
+      ClkPub  = sim_time();
+   }
+}
+
+static int ClockBench(void)
+{
+   unsigned char seq, row, p;
+   unsigned int  num;
+   double t0, e0, a0, frame, lat, lat_sum, lat_max, pub = 0.0;
+   double energy[CLK_PROFILES];
+   int    fails = 0;
+   int    pending;
+   RpmSnap snap;
+
+   printf("\nClock profiles: display loop of Measure for %.0f s, gate mode, reading "
+          "every %d ms, %.0f rpm, %d magnets\n\n", CLK_RUN, BIN_MS, CLK_RPM, CLK_MAGNETS);
+   printf("%-8s %8s %9s %9s %9s %8s %9s %9s\n", "profile", "kHz",
+          "frame ms", "upd avg", "upd max", "active%", "uJ/s", "uA avg");
+
+   for(p = 0; p < CLK_PROFILES; p++)
+   {
+      sim_reset();
+      NumMagnets  = CLK_MAGNETS;
+      AcqSecTime  = 1;
+      MeasMode    = MEAS_GATE;
+      RefreshBins = 1;
+      GlitchMode  = FILTER_FIXED;
+      TripMode    = TRIP_OFF;
+
+      InitPeriph();
+      InitFreq();
+      InitTimer();
+      LCDInit();
+      ClkEdge  = sim_time();
+      ClkLevel = 0;
+      sim_set_hall(ClockWave, NULL);
+      ClockSet(p);
+      eint();
+
+      /* Full frame, as at the screen change */
+      LCDClear();
+      for(row = 0; row < 6; row++)
+         LCDStr(row, (unsigned char *)" Measuring 123");
+      t0 = sim_time();
+      LCDUpdate();
+      LCDWait();
+      frame = sim_time() - t0;
+
+      RpmStart();
+      seq     = Rpm_seq;
+      ClkSeen = Rpm_seq;
+      sim_set_isr_hook(ClockHook);
+      t0 = sim_time();
+      e0 = sim_energy();
+      a0 = sim_active_time();
+      lat_sum = lat_max = 0.0;
+      num     = 0;
+      pending = 0;
+
+      while(sim_time() < t0 + CLK_RUN)
+      {
+         if(RpmRead(&snap, &seq))
+         {
+            LCDNum ( 8, 3, snap.count, 6, 0 );
+            LCDNum ( 6, 4, RpmTenths(&snap), 8, 1 );
+            LCDUpdate();
+            pub     = ClkPub;
+            pending = 1;
+         }
+         if(pending && !LCDBusy())
+         {
+            lat = sim_time() - pub;
+            lat_sum += lat;
+            if(lat > lat_max)
+               lat_max = lat;
+            num++;
+            pending = 0;
+         }
+         SysSleep(MODE_LPM3);
+      }
+      sim_set_isr_hook(NULL);
+      t0 = sim_time() - t0;
+      energy[p] = (sim_energy() - e0) / t0;
+
+      printf("%-8s %8.0f %9.2f %9.3f %9.3f %8.3f %9.2f %9.2f\n", ClockName[p],
+             ClockKhz[p], frame * 1e3, num ? lat_sum / num * 1e3 : 0.0, lat_max * 1e3,
+             (sim_active_time() - a0) * 100.0 / t0, (sim_energy() - e0) / t0 * 1e6,
+             (sim_energy() - e0) / t0 / 3.0 * 1e6);
+
+      fails += Check(num && lat_max * 1e3 < BIN_MS, "%s: display update up to %.3f ms",
+                     ClockName[p], lat_max * 1e3);
+   }
+
+   /* CLK_MAIN is the profile of the firmware */
+   for(p = 0; p < CLK_PROFILES; p++)
+      fails += Check(energy[CLK_MAIN] <= energy[p], "%s takes less energy than CLK_MAIN",
+                     ClockName[p]);
+   CheckEnd("clock", fails);
+   return fails;
+}
+
+/*
+ *  Acquisition: every train in every mode, magnets and gate
+ */
+static int AcqBench(void)
+{
+   unsigned int tr;
+   int    mode, magnets, gate, n, nerr, never;
+   int    fails = 0;
+   double err_avg, err_max, tok_avg, tok_max, isr_avg, isr_max;
+   Result r;
+
+   if(Csv)
+      printf("mode,train,magnets,gate,err_avg,err_max,t_ok,isr_s,upd_s\n");
+   else
+   {
+      printf("Hall pulse-train bench: magnets 1-8, gate 1-%d s, refresh %d ms, "
+             "filter %s, tolerance %.1f%%\n\n", MAX_GATE, Refresh * BIN_MS,
+             FilterName[Filter], TOLERANCE);
+      printf("%-8s %-9s %9s %9s %9s %9s %6s %9s %9s\n", "mode", "train",
+             "err avg%", "err max%", "t_ok avg", "t_ok max", "never",
+             "isr/s avg", "isr/s max");
+   }
+
+   for(mode = 0; mode < MEAS_NUM; mode++)
+   {
+      for(tr = 0; tr < NUM_TRAINS; tr++)
+      {
+         err_avg = err_max = tok_avg = tok_max = isr_avg = isr_max = 0.0;
+         n = nerr = never = 0;
+
+         for(magnets = 1; magnets <= MAX_MAGNETS; magnets++)
+         {
+            /* The auto mode does not use the gate setting */
+            for(gate = 1; gate <= (mode == MEAS_AUTO ? 1 : MAX_GATE); gate++)
+            {
+               RunCase(&Trains[tr], mode, magnets, gate, &r);
+
+               if(Csv)
+                  printf("%s,%s,%d,%d,%.3f,%.3f,%.3f,%.1f,%.2f\n", ModeName[mode],
+                         Trains[tr].name, magnets, gate, r.err_avg, r.err_max,
+                         r.t_ok, r.isr_rate, r.upd_rate);
+
+               n++;
+               if(!isnan(r.err_avg))
+               {
+                  nerr++;
+                  err_avg += r.err_avg;
+                  if(r.err_max > err_max)
+                     err_max = r.err_max;
+               }
+               if(r.t_ok < 0.0)
+                  never++;
+               else
+               {
+                  tok_avg += r.t_ok;
+                  if(r.t_ok > tok_max)
+                     tok_max = r.t_ok;
+               }
+               isr_avg += r.isr_rate;
+               if(r.isr_rate > isr_max)
+                  isr_max = r.isr_rate;
+            }
+         }
+
+         if(!Csv)
+         {
+            printf("%-8s %-9s ", ModeName[mode], Trains[tr].name);
+            if(nerr)
+               printf("%9.3f %9.3f ", err_avg / nerr, err_max);
+            else
+               printf("%9s %9s ", "-", "-");
+            if(n > never)
+               printf("%9.3f %9.3f ", tok_avg / (n - never), tok_max);
+            else
+               printf("%9s %9s ", "-", "-");
+            printf("%6d %9.1f %9.1f\n", never, isr_avg / n, isr_max);
+         }
+
+         /* The hardware counter and an unfiltered edge count every bounce */
+         if(Trains[tr].bounce && (mode == MEAS_HWCOUNT || Filter == FILTER_OFF))
+            continue;
+         fails += Check(!nerr || err_avg / nerr <= Trains[tr].err_lim,
+                        "%s %s: err avg %.3f%%", ModeName[mode], Trains[tr].name,
+                        err_avg / nerr);
+         fails += Check(never <= Trains[tr].never_lim * n, "%s %s: %d of %d cases never correct",
+                        ModeName[mode], Trains[tr].name, never, n);
+      }
+   }
+   CheckEnd("acq", fails);
+   return fails;
+}
+
+typedef struct
+{
+   const char *name;
+   int  (*run)(void);
+} Section;
+
+static const Section Sections[] =
+{
+   { "acq",   AcqBench   },
+   { "slow",  SlowBench  },
+   { "trip",  TripBench  },
+   { "cal",   CalBench   },
+   { "log",   LogBench   },
+   { "clock", ClockBench },
+};
+
+#define NUM_SECTIONS   (sizeof(Sections) / sizeof(Sections[0]))
+
+int main(int argc, char **argv)
+{
+   unsigned char run[NUM_SECTIONS];
+   unsigned int  s;
+   int    n, all = 1;
+   int    fails = 0;
+
+   memset(run, 0, sizeof(run));
+   for(n = 1; n < argc; n++)
+   {
+      if(!strcmp(argv[n], "-c"))
+         Csv = 1;
+      else if(!strcmp(argv[n], "-r") && n + 1 < argc)
+         Refresh = atoi(argv[++n]);
+      else if(!strcmp(argv[n], "-f") && n + 1 < argc)
+      {
+         n++;
+         for(Filter = 0; Filter < FILTER_NUM; Filter++)
+            if(!strcmp(argv[n], FilterName[Filter]))
+               break;
+      }
+      else
+      {
+         for(s = 0; s < NUM_SECTIONS && strcmp(argv[n], Sections[s].name); s++)
+            ;
+         if(s < NUM_SECTIONS)
+            run[s] = 1;
+         else
+            Filter = FILTER_NUM;
+         all = 0;
+      }
+
+      if(Filter >= FILTER_NUM)
+      {
+         fprintf(stderr, "usage: %s [-c] [-r bins] [-f off|fixed|auto] "
+                 "[acq|slow|trip|cal|log|clock ...]\n", argv[0]);
+         return 2;
+      }
+   }
+   if(Refresh < 1 || Refresh > BINS_PER_SEC)
+      Refresh = 1;
+
+   /* The CSV has the acquisition cases only */
+   for(s = 0; s < NUM_SECTIONS; s++)
+   {
+      if((all || run[s]) && (!Csv || Sections[s].run == AcqBench))
+         fails += Sections[s].run();
+   }
+   return fails ? 1 : 0;
+}
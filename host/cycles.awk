@@ -0,0 +1,113 @@
+#
+#  @file cycles.awk
+#  @author TheFwGuy
+#  @version 1.0
+#  @date October 2026
+#  @brief Static cycle count of the functions in an msp430-objdump -d listing
+#
+#  For every function named in the variable hot (space separated) prints
+#    name  instructions  bytes  cycles
+#  where cycles is the sum of the MCLK cycles of every instruction of the
+#  function, from the MSP430x1xx instruction timing tables. Every instruction
+#  is counted once: for loop free code it is the cost of the longest path
+#  plus the skipped branches, a stable figure to compare two builds.
+#  Interrupt entry (6 cycles) is not included, reti is.
+#
+#  Usage: msp430-objdump -d rpm.elf | awk -v hot="Timer_A RpmRead" -f cycles.awk
+#
+
+# Addressing mode of an operand: R register (or constant generator),
+# N indirect, A autoincrement, I immediate, X indexed/symbolic/absolute
+function amode(op,   v)
+{
+   gsub(/[ \t]/, "", op)
+   if(op ~ /^#/)
+   {
+      v = tolower(substr(op, 2))
+      if(v ~ /^(0|1|2|4|8|-1|0x0*[1248]|0x0+|0xffff|0xff)$/)
+         return "R"
+      return "I"
+   }
+   if(op ~ /^@r[0-9]+\+$/)
+      return "A"
+   if(op ~ /^@r[0-9]+$/)
+      return "N"
+   if(op ~ /^(r[0-9]+|pc|sp|sr)$/)
+      return "R"
+   return "X"
+}
+
+function ispc(op)
+{
+   gsub(/[ \t]/, "", op)
+   return op == "r0" || op == "pc"
+}
+
+# Double operand instructions
+function fmt1(src, dst,   s, d)
+{
+   s = amode(src)
+   if(ispc(dst))
+      return (s == "R" || s == "N") ? 2 : 3
+   d = amode(dst)
+   if(d == "R")
+      return s == "R" ? 1 : (s == "X" ? 3 : 2)
+   return s == "R" ? 4 : (s == "X" ? 6 : 5)
+}
+
+function cycles(mn, ops,   n, o, m)
+{
+   sub(/\.[bwa]$/, "", mn)
+   n = split(ops, o, ",")
+
+   if(mn ~ /^j/)                      return 2
+   if(mn == "reti")                   return 5
+   if(mn == "ret")                    return 3
+   if(mn == "nop")                    return 1
+   if(mn ~ /^(setc|clrc|setz|clrz|setn|clrn|dint|eint)$/)
+      return 1
+
+   m = amode(o[1])
+   if(mn == "push")                   return m == "R" ? 3 : (m == "X" ? 5 : 4)
+   if(mn == "call")                   return m == "R" || m == "N" ? 4 : 5
+   if(mn ~ /^(rra|rrc|swpb|sxt)$/)    return m == "R" ? 1 : (m == "X" ? 4 : 3)
+   if(mn == "pop")                    return fmt1("@r1+", o[1])
+   if(mn == "br")                     return fmt1(o[1], "r0")
+   if(mn ~ /^(rla|rlc)$/)             return fmt1(o[1], o[1])
+   if(n == 1)                         return fmt1("#0", o[1])   # clr, inc, tst, ...
+   return fmt1(o[1], o[2])
+}
+
+BEGIN {
+   nhot = split(hot, h, " ")
+   for(i = 1; i <= nhot; i++)
+      want[h[i]] = 1
+   fn = ""
+}
+
+# Function label: "0000fc3a <Timer_A>:"
+/^[0-9a-f]+ <[^>]+>:$/ {
+   name = $2
+   gsub(/[<>:]/, "", name)
+   fn = (name in want) ? name : ""
+   next
+}
+
+# Instruction: "    fc3a:<tab>0f 12       <tab>push<tab>r15 ; comment"
+fn != "" && /^ +[0-9a-f]+:\t/ {
+   nf = split($0, f, "\t")
+   if(nf < 3 || f[3] == "")
+      next
+   mn  = f[3]
+   gsub(/ /, "", mn)
+   ops = nf >= 4 ? f[4] : ""
+   sub(/;.*/, "", ops)
+   insn[fn]++
+   bytes[fn] += split(f[2], b, " ")
+   cyc[fn]   += cycles(mn, ops)
+}
+
+END {
+   for(i = 1; i <= nhot; i++)
+      printf "%-16s %5d %6d %6d\n", h[i], insn[h[i]], bytes[h[i]], cyc[h[i]]
+}
@@ -0,0 +1,197 @@
+/**
+ *  @file fmtbench.c
+ *  @author TheFwGuy
+ *  @version 1.0
+ *  @date October 2026
+ *  @brief Benchmark of the LCD number formatter against sprintf
+ *
+ *  LCDFmtNum() is first checked against the equivalent printf formats on a
+ *  set of values (all widths, 0-2 decimals, overflow), then both are timed
+ *  on the display formats used by Measure() and SetParam().
+ *
+ *  The host has a hardware divider and an optimized libc, so the host timings
+ *  favour sprintf. The MSP430F169 has no divider: printf needs a 32 bit
+ *  software division (__udivmodsi4, a 32 step shift/subtract loop) for every
+ *  digit, while LCDFmtNum() needs one 32 bit compare/subtract per unit of
+ *  every digit. The bench counts both and prints an estimate of the target
+ *  cycles from DIV_CYCLES and SUB_CYCLES. The flash footprint on the target
+ *  is given by 'make size' (msp430-size).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "lcd_new.h"
+
+#define LOOPS   2000000UL
+
+#define DIV_CYCLES   330    /* __udivmodsi4 on the MSP430, 32 iterations */
+#define SUB_CYCLES   10     /* 32 bit compare, subtract and branch */
+
+static unsigned long Values[] =
+{
+   0, 1, 9, 10, 99, 100, 999, 1000, 12345, 65535, 65536, 99999, 100000,
+   999999, 1000000, 12345678, 99999999, 100000000, 4294967295UL
+};
+
+#define NUM_VALUES   (sizeof(Values) / sizeof(Values[0]))
+
+/* Firmware configuration used by system.c, normally owned by main.c */
+unsigned char MeasMode;
+
+/* Reference formatting with printf, same rules as LCDFmtNum() */
+static void Reference(char *buf, unsigned long value, int width, int decimals)
+{
+   char tmp[32];
+   unsigned long div = 1;
+   int   i, len;
+
+   for(i = 0; i < decimals; i++)
+      div *= 10;
+
+   if(decimals)
+      len = sprintf(tmp, "%*lu.%0*lu", width - decimals - 1, value / div,
+                    decimals, value % div);
+   else
+      len = sprintf(tmp, "%*lu", width, value);
+
+   if(len > width)
+      memset(buf, '*', width);
+   else
+      memcpy(buf, tmp, width);
+}
+
+/* Digits of the value as LCDFmtNum() prints them */
+static int Digits(unsigned long value, int decimals)
+{
+   int n = 1;
+
+   while(value >= 10)
+   {
+      value /= 10;
+      n++;
+   }
+   return n > decimals + 1 ? n : decimals + 1;
+}
+
+/* Compare/subtract steps of LCDFmtNum(): digit value + 1 for every digit */
+static int Steps(unsigned long value, int decimals)
+{
+   int n = Digits(value, decimals);
+   int steps = n;
+
+   while(n--)
+   {
+      steps += value % 10;
+      value /= 10;
+   }
+   return steps;
+}
+
+static double Now(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(void)
+{
+   char  a[LCD_NUM_WIDTH + 1], b[LCD_NUM_WIDTH + 1];
+   char  line[32];
+   unsigned int i;
+   int   width, dec, errors = 0;
+   unsigned long n;
+   volatile unsigned long sink = 0;
+   double t, t_printf, t_fmt;
+   double divs, subs;
+
+   /* Check */
+   for(i = 0; i < NUM_VALUES; i++)
+   {
+      for(dec = 0; dec <= 2; dec++)
+      {
+         for(width = dec + (dec ? 2 : 1); width <= LCD_NUM_WIDTH; width++)
+         {
+            memset(a, 0, sizeof(a));
+            memset(b, 0, sizeof(b));
+            LCDFmtNum(a, Values[i], width, dec);
+            Reference(b, Values[i], width, dec);
+            if(memcmp(a, b, width))
+            {
+               printf("mismatch: %lu width %d dec %d: '%s' expected '%s'\n",
+                      Values[i], width, dec, a, b);
+               errors++;
+            }
+         }
+      }
+   }
+   printf("check: %s\n", errors ? "FAILED" : "ok");
+
+   /* RPM with one decimal, as in the period mode */
+   t = Now();
+   for(n = 0; n < LOOPS; n++)
+   {
+      sprintf(line, " RPM = %lu.%u   ", n / 10, (unsigned int)(n % 10));
+      sink += line[7];
+   }
+   t_printf = (Now() - t) / LOOPS;
+
+   t = Now();
+   for(n = 0; n < LOOPS; n++)
+   {
+      LCDFmtNum(a, n, 8, 1);
+      sink += a[7];
+   }
+   t_fmt = (Now() - t) / LOOPS;
+
+   divs = subs = 0.0;
+   for(n = 0; n < LOOPS; n += 997)
+   {
+      divs += Digits(n, 1);
+      subs += Steps(n, 1);
+   }
+   divs /= LOOPS / 997 + 1;
+   subs /= LOOPS / 997 + 1;
+
+   printf("rpm x.y   host: sprintf %7.1f ns  LCDFmtNum %7.1f ns\n",
+          t_printf * 1e9, t_fmt * 1e9);
+   printf("          target estimate: sprintf >= %4.0f cycles (%.1f divisions)"
+          "  LCDFmtNum %4.0f cycles (%.1f steps)\n",
+          divs * DIV_CYCLES, divs, subs * SUB_CYCLES, subs);
+
+   /* Small setting value */
+   t = Now();
+   for(n = 0; n < LOOPS; n++)
+   {
+      sprintf(line, " Timer (s): %u", (unsigned int)(n & 7) + 1);
+      sink += line[12];
+   }
+   t_printf = (Now() - t) / LOOPS;
+
+   t = Now();
+   for(n = 0; n < LOOPS; n++)
+   {
+      LCDFmtNum(a, (n & 7) + 1, 3, 0);
+      sink += a[2];
+   }
+   t_fmt = (Now() - t) / LOOPS;
+
+   divs = subs = 0.0;
+   for(n = 1; n <= 8; n++)
+   {
+      divs += Digits(n, 0);
+      subs += Steps(n, 0);
+   }
+   divs /= 8;
+   subs /= 8;
+
+   printf("setting   host: sprintf %7.1f ns  LCDFmtNum %7.1f ns\n",
+          t_printf * 1e9, t_fmt * 1e9);
+   printf("          target estimate: sprintf >= %4.0f cycles (%.1f divisions)"
+          "  LCDFmtNum %4.0f cycles (%.1f steps)\n",
+          divs * DIV_CYCLES, divs, subs * SUB_CYCLES, subs);
+
+   return errors ? 1 : 0;
+}
@@ -0,0 +1,166 @@
+/**
+ *  @file logdec.c
+ *  @author TheFwGuy
+ *  @version 1.0
+ *  @date October 2026
+ *  @brief Decoder of the flash log to CSV
+ *
+ *  Usage: logdec [-i] [file | serial port]   (stdin when omitted)
+ *
+ *  The input is the log dump sent on the telemetry UART (log.c, LogDump),
+ *  or with -i a flash image saved by the simulator (SIM_FLASH, 0x1000 -
+ *  0xFFFF). A serial port (or pty) is set raw at 9600 8N1 and read until
+ *  the end of the dump. One CSV line is printed for every sample, the
+ *  totals and the density (samples per KB of flash) go on stderr.
+ *
+ *    SIM_FLASH=/tmp/flash.bin SIM_KEYS=... ./hostbuild/rpm_host
+ *    ./hostbuild/logdec -i /tmp/flash.bin
+ */
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include "log.h"
+#include "logread.h"
+
+#define IMAGE_BASE   0x1000
+#define IMAGE_SIZE   (0x10000 - IMAGE_BASE)
+
+static unsigned char Area[LOG_SEGS * LOG_SEG];
+
+/* Raw 9600 8N1 when the input is a serial port or a pty */
+static void SerialSetup(int fd)
+{
+   struct termios tio;
+
+   if(!isatty(fd) || tcgetattr(fd, &tio) < 0)
+      return;
+   cfmakeraw(&tio);
+   cfsetispeed(&tio, B9600);
+   cfsetospeed(&tio, B9600);
+   tio.c_cflag |= CLOCAL | CREAD;
+   tio.c_cflag &= ~(CSTOPB | PARENB);
+   tio.c_cc[VMIN]  = 1;
+   tio.c_cc[VTIME] = 0;
+   tcsetattr(fd, TCSANOW, &tio);
+}
+
+static int Byte(int fd)
+{
+   unsigned char b;
+
+   return read(fd, &b, 1) == 1 ? b : -1;
+}
+
+/* Image saved by the simulator */
+static int Image(int fd)
+{
+   static unsigned char img[IMAGE_SIZE];
+   size_t n = 0;
+   ssize_t r;
+
+   while(n < sizeof(img) && (r = read(fd, img + n, sizeof(img) - n)) > 0)
+      n += r;
+   if(n != sizeof(img))
+   {
+      fprintf(stderr, "logdec: image of %lu bytes, %d expected\n", (unsigned long)n, IMAGE_SIZE);
+      return -1;
+   }
+   memcpy(Area, img + LOG_BASE - IMAGE_BASE, sizeof(Area));
+   return 0;
+}
+
+/* Dump from the target, until its end or the end of the input */
+static int Dump(int fd)
+{
+   unsigned char seg[LOG_SEG];
+   unsigned char sum;
+   int   c, slot, i, got = 0, bad = 0;
+
+   while((c = Byte(fd)) >= 0)
+   {
+      if(c != LOG_DUMP_SYNC0)
+         continue;
+      c = Byte(fd);
+      if(c == LOG_DUMP_END)
+      {
+         c = Byte(fd);
+         if(c != got)
+            fprintf(stderr, "logdec: %d segments received, %d sent\n", got, c);
+         break;
+      }
+      if(c != LOG_DUMP_SEG || (slot = Byte(fd)) < 0)
+         continue;
+      if(slot >= LOG_SEGS)
+      {
+         bad++;
+         continue;
+      }
+      for(i = 0, sum = 0; i < LOG_SEG && (c = Byte(fd)) >= 0; i++)
+      {
+         seg[i] = c;
+         sum   += c;
+      }
+      if(i < LOG_SEG || (c = Byte(fd)) < 0)
+         break;
+      if(c != sum)
+      {
+         bad++;
+         continue;
+      }
+      memcpy(Area + slot * LOG_SEG, seg, LOG_SEG);
+      got++;
+   }
+   if(bad)
+      fprintf(stderr, "logdec: %d segments with a bad checksum\n", bad);
+   return got ? 0 : -1;
+}
+
+static void Sample(void *ctx, unsigned long stamp, unsigned long rpm10, int run)
+{
+   (void)ctx;
+   printf("%d,%.6f,%lu.%lu\n", run, stamp / 32768.0, rpm10 / 10, rpm10 % 10);
+}
+
+int main(int argc, char **argv)
+{
+   LogStat st;
+   int   fd = 0, image = 0, n = 1;
+
+   if(n < argc && !strcmp(argv[n], "-i"))
+   {
+      image = 1;
+      n++;
+   }
+   if(n < argc)
+   {
+      fd = open(argv[n], O_RDONLY | O_NOCTTY);
+      if(fd < 0)
+      {
+         perror(argv[n]);
+         return 1;
+      }
+   }
+   SerialSetup(fd);
+
+   memset(Area, 0xFF, sizeof(Area));
+   if(image ? Image(fd) : Dump(fd))
+   {
+      fprintf(stderr, "logdec: no log found\n");
+      return 1;
+   }
+
+   printf("run,time_s,rpm\n");
+   LogDecode(Area, Sample, NULL, &st);
+
+   fprintf(stderr, "logdec: %d segments, %lu records (%lu bad), %d runs, %lu samples "
+           "in %lu bytes, %.0f samples/KB\n", st.segs, st.records, st.bad, st.runs,
+           st.samples, st.bytes, st.bytes ? st.samples * 1024.0 / st.bytes : 0.0);
+   return 0;
+}
+
+/*
+ *  This code is documented using DoxyGen
+ *  (http://www.stack.nl/~dimitri/doxygen/index.html)
+ */
@@ -0,0 +1,140 @@
+/**
+ *  @file logread.c
+ *  @author TheFwGuy
+ *  @version 1.0
+ *  @date October 2026
+ *  @brief Decoder of the flash log (log.c), shared by the host tools
+ *
+ *  The segments are ordered by their sequence number, from the oldest to
+ *  the newest, and every record is checked (length, checksum, encoding)
+ *  before its samples are handed over.
+ */
+#include <string.h>
+#include "log.h"
+#include "logread.h"
+
+static int Header(const unsigned char *seg, unsigned short *seq)
+{
+   *seq = seg[1] | (seg[2] << 8);
+   return seg[0] == LOG_MAGIC && seg[3] == LOG_CHECK(seg[1], seg[2]);
+}
+
+/* Varint at *pos, 0 if it runs past end or over 32 bits */
+static int Varint(const unsigned char *rec, int *pos, int end, unsigned long *val)
+{
+   int shift = 0;
+
+   *val = 0;
+   for(;;)
+   {
+      if(*pos >= end || shift > 28)
+         return 0;
+      *val |= (unsigned long)(rec[*pos] & 0x7F) << shift;
+      if(!(rec[(*pos)++] & 0x80))
+         return 1;
+      shift += 7;
+   }
+}
+
+static long Unzigzag(unsigned long v)
+{
+   return (long)(v >> 1) ^ -(long)(v & 1);
+}
+
+/* Checks a record and hands over its samples, 0 if it is bad */
+static int Record(const unsigned char *rec, int len, log_sample_fn fn, void *ctx, LogStat *st)
+{
+   unsigned long stamp, val, tag, ddt, dt = 0;
+   unsigned char sum = 0;
+   int   n = rec[1], pos = LOG_REC_HDR, end = len - 1, i;
+
+   for(i = 0; i < end; i++)
+      sum += rec[i];
+   if(sum != rec[end] || n == 0)
+      return 0;
+
+   stamp = rec[3] | ((unsigned long)rec[4] << 8) | ((unsigned long)rec[5] << 16) |
+           ((unsigned long)rec[6] << 24);
+   if(!Varint(rec, &pos, end, &val))
+      return 0;
+   if(rec[2] & LOG_RUN)
+      st->runs++;
+   fn(ctx, stamp, val, st->runs);
+
+   for(i = 1; i < n; i++)
+   {
+      if(!Varint(rec, &pos, end, &tag))
+         return 0;
+      if(tag & 1)
+      {
+         if(!Varint(rec, &pos, end, &ddt))
+            return 0;
+         dt = (dt + Unzigzag(ddt)) & 0xFFFFFFFFUL;
+      }
+      /* 32 bit arithmetic, as on the target */
+      val   = (val + Unzigzag(tag >> 1)) & 0xFFFFFFFFUL;
+      stamp = (stamp + dt) & 0xFFFFFFFFUL;
+      fn(ctx, stamp, val, st->runs);
+   }
+   st->samples += n;
+   return pos == end;
+}
+
+void LogDecode(const unsigned char *area, log_sample_fn fn, void *ctx, LogStat *st)
+{
+   unsigned short seq[LOG_SEGS], newest = 0;
+   int   valid[LOG_SEGS];
+   int   order[LOG_SEGS];
+   int   i, j, k, pos, len;
+   const unsigned char *seg;
+
+   memset(st, 0, sizeof(*st));
+
+   for(i = 0; i < LOG_SEGS; i++)
+   {
+      valid[i] = Header(area + i * LOG_SEG, &seq[i]);
+      if(valid[i] && (!st->segs || (short)(seq[i] - newest) > 0))
+         newest = seq[i];
+      st->segs += valid[i];
+   }
+
+   /* Oldest first: the largest distance back from the newest */
+   for(i = k = 0; i < LOG_SEGS; i++)
+   {
+      if(!valid[i])
+         continue;
+      for(j = k; j > 0 && (unsigned short)(newest - seq[order[j - 1]]) <
+                          (unsigned short)(newest - seq[i]); j--)
+         order[j] = order[j - 1];
+      order[j] = i;
+      k++;
+   }
+
+   for(i = 0; i < k; i++)
+   {
+      seg = area + order[i] * LOG_SEG;
+      for(pos = LOG_HDR; pos < LOG_SEG; pos += len)
+      {
+         len = seg[pos];
+         if(len == 0xFF)
+            break;
+         if(len < LOG_REC_HDR + 2 || pos + len > LOG_SEG)
+         {
+            st->bad++;
+            break;
+         }
+         if(Record(seg + pos, len, fn, ctx, st))
+         {
+            st->records++;
+            st->bytes += len;
+         }
+         else
+            st->bad++;
+      }
+   }
+}
+
+/*
+ *  This code is documented using DoxyGen
+ *  (http://www.stack.nl/~dimitri/doxygen/index.html)
+ */
@@ -0,0 +1,30 @@
+/**
+ *  @file logread.h
+ *  @author TheFwGuy
+ *  @version 1.0
+ *  @date October 2026
+ *  @brief Decoder of the flash log (log.c), shared by the host tools
+ */
+#ifndef __LOGREAD_H
+#define __LOGREAD_H
+
+/* One decoded sample: run counts the LOG_RUN records met so far */
+typedef void (*log_sample_fn)(void *ctx, unsigned long stamp, unsigned long rpm10, int run);
+
+typedef struct
+{
+   int           segs;       /* segments with a valid header */
+   unsigned long records;    /* good records */
+   unsigned long bad;        /* records with a bad checksum or encoding */
+   unsigned long samples;
+   unsigned long bytes;      /* bytes of the good records */
+   int           runs;
+} LogStat;
+
+/*
+ *  area : LOG_SEGS * LOG_SEG bytes, segment n at n * LOG_SEG (0xFF where
+ *  a segment is missing). The segments are decoded oldest first.
+ */
+void LogDecode(const unsigned char *area, log_sample_fn fn, void *ctx, LogStat *st);
+
+#endif
@@ -0,0 +1,427 @@
+/**
+ *  @file msp430_sim.h
+ *  @author TheFwGuy
+ *  @version 1.0
+ *  @date October 2026
+ *  @brief Host replacement for the mspgcc <io.h>/<signal.h> pair
+ *
+ *  Every MSP430F169 register used by the firmware is mapped on a small
+ *  simulated address space. Each access goes through sim_reg8/sim_reg16,
+ *  which lets the simulator advance the time, update the peripherals and
+ *  dispatch the pending interrupts before the firmware touches the register.
+ */
+#ifndef __MSP430_SIM_H
+#define __MSP430_SIM_H
+
+volatile unsigned char  *sim_reg8(unsigned int addr);
+volatile unsigned short *sim_reg16(unsigned int addr);
+void sim_bis_sr(unsigned short bits);
+void sim_bic_sr(unsigned short bits);
+void sim_bic_sr_irq(unsigned short bits);
+void sim_bis_sr_irq(unsigned short bits);
+unsigned short sim_read_sr(void);
+volatile unsigned char *sim_flash8(unsigned int addr);
+
+#define SFR8(addr)    (*sim_reg8(addr))
+#define SFR16(addr)   (*sim_reg16(addr))
+#define FLASH8(addr)  (*sim_flash8(addr))
+
+/*
+ *  Intrinsics
+ */
+#define interrupt(vec)     void
+#define eint()             sim_bis_sr(GIE)
+#define dint()             sim_bic_sr(GIE)
+#define nop()              sim_bis_sr(0)
+#define _BIS_SR(x)         sim_bis_sr(x)
+#define _BIC_SR(x)         sim_bic_sr(x)
+#define _BIS_SR_IRQ(x)     sim_bis_sr_irq(x)
+#define _BIC_SR_IRQ(x)     sim_bic_sr_irq(x)
+#define READ_SR            sim_read_sr()
+
+/* Status register */
+#define GIE                0x0008
+#define CPUOFF             0x0010
+#define OSCOFF             0x0020
+#define SCG0               0x0040
+#define SCG1               0x0080
+
+#define LPM0_bits          (CPUOFF)
+#define LPM1_bits          (SCG0+CPUOFF)
+#define LPM2_bits          (SCG1+CPUOFF)
+#define LPM3_bits          (SCG1+SCG0+CPUOFF)
+#define LPM4_bits          (SCG1+SCG0+OSCOFF+CPUOFF)
+
+#define LPM0               _BIS_SR(LPM0_bits)
+#define LPM0_EXIT          _BIC_SR_IRQ(LPM0_bits)
+#define LPM3               _BIS_SR(LPM3_bits)
+#define LPM3_EXIT          _BIC_SR_IRQ(LPM3_bits)
+
+/* Generic bits */
+#define BIT0               0x0001
+#define BIT1               0x0002
+#define BIT2               0x0004
+#define BIT3               0x0008
+#define BIT4               0x0010
+#define BIT5               0x0020
+#define BIT6               0x0040
+#define BIT7               0x0080
+#define BIT8               0x0100
+#define BIT9               0x0200
+#define BITA               0x0400
+#define BITB               0x0800
+#define BITC               0x1000
+#define BITD               0x2000
+#define BITE               0x4000
+#define BITF               0x8000
+
+/*
+ *  Special function registers
+ */
+#define IE1                SFR8(0x0000)
+#define IE2                SFR8(0x0001)
+#define IFG1               SFR8(0x0002)
+#define IFG2               SFR8(0x0003)
+#define ME1                SFR8(0x0004)
+#define ME2                SFR8(0x0005)
+
+#define WDTIE              0x01
+#define OFIE               0x02
+#define NMIIE              0x10
+#define ACCVIE             0x20
+#define URXIE0             0x40
+#define UTXIE0             0x80
+#define URXIE1             0x10
+#define UTXIE1             0x20
+
+#define WDTIFG             0x01
+#define OFIFG              0x02
+#define NMIIFG             0x10
+#define URXIFG0            0x40
+#define UTXIFG0            0x80
+#define URXIFG1            0x10
+#define UTXIFG1            0x20
+
+#define URXE0              0x40
+#define UTXE0              0x80
+#define USPIE0             0x40
+#define URXE1              0x10
+#define UTXE1              0x20
+#define USPIE1             0x10
+
+/*
+ *  Digital I/O
+ */
+#define P1IN               SFR8(0x0020)
+#define P1OUT              SFR8(0x0021)
+#define P1DIR              SFR8(0x0022)
+#define P1IFG              SFR8(0x0023)
+#define P1IES              SFR8(0x0024)
+#define P1IE               SFR8(0x0025)
+#define P1SEL              SFR8(0x0026)
+
+#define P2IN               SFR8(0x0028)
+#define P2OUT              SFR8(0x0029)
+#define P2DIR              SFR8(0x002A)
+#define P2IFG              SFR8(0x002B)
+#define P2IES              SFR8(0x002C)
+#define P2IE               SFR8(0x002D)
+#define P2SEL              SFR8(0x002E)
+
+#define P3IN               SFR8(0x0018)
+#define P3OUT              SFR8(0x0019)
+#define P3DIR              SFR8(0x001A)
+#define P3SEL              SFR8(0x001B)
+
+#define P4IN               SFR8(0x001C)
+#define P4OUT              SFR8(0x001D)
+#define P4DIR              SFR8(0x001E)
+#define P4SEL              SFR8(0x001F)
+
+#define P5IN               SFR8(0x0030)
+#define P5OUT              SFR8(0x0031)
+#define P5DIR              SFR8(0x0032)
+#define P5SEL              SFR8(0x0033)
+
+#define P6IN               SFR8(0x0034)
+#define P6OUT              SFR8(0x0035)
+#define P6DIR              SFR8(0x0036)
+#define P6SEL              SFR8(0x0037)
+
+/*
+ *  Basic clock system
+ */
+#define DCOCTL             SFR8(0x0056)
+#define BCSCTL1            SFR8(0x0057)
+#define BCSCTL2            SFR8(0x0058)
+#define BCSCTL3            SFR8(0x0053)
+
+#define MOD0               0x01
+#define DCO0               0x20
+#define DCO1               0x40
+#define DCO2               0x80
+
+#define RSEL0              0x01
+#define RSEL1              0x02
+#define RSEL2              0x04
+#define XT5V               0x08
+#define DIVA_0             0x00
+#define DIVA_1             0x10
+#define DIVA_2             0x20
+#define DIVA_3             0x30
+#define XTS                0x40
+#define XT2OFF             0x80
+
+#define DCOR               0x01
+#define DIVS_0             0x00
+#define DIVS_1             0x02
+#define DIVS_2             0x04
+#define DIVS_3             0x06
+#define SELS               0x08
+#define DIVM_0             0x00
+#define DIVM_1             0x10
+#define DIVM_2             0x20
+#define DIVM_3             0x30
+#define SELM_0             0x00
+#define SELM_1             0x40
+#define SELM_2             0x80
+#define SELM_3             0xC0
+
+/*
+ *  Watchdog timer
+ */
+#define WDTCTL             SFR16(0x0120)
+
+#define WDTIS0             0x0001
+#define WDTIS1             0x0002
+#define WDTSSEL            0x0004
+#define WDTCNTCL           0x0008
+#define WDTTMSEL           0x0010
+#define WDTNMI             0x0020
+#define WDTNMIES           0x0040
+#define WDTHOLD            0x0080
+#define WDTPW              0x5A00
+
+#define WDT_MDLY_32        (WDTPW+WDTTMSEL+WDTCNTCL)
+#define WDT_MDLY_8         (WDTPW+WDTTMSEL+WDTCNTCL+WDTIS0)
+#define WDT_MDLY_0_5       (WDTPW+WDTTMSEL+WDTCNTCL+WDTIS1)
+#define WDT_MDLY_0_064     (WDTPW+WDTTMSEL+WDTCNTCL+WDTIS1+WDTIS0)
+#define WDT_ADLY_1000      (WDTPW+WDTTMSEL+WDTCNTCL+WDTSSEL)
+#define WDT_ADLY_250       (WDTPW+WDTTMSEL+WDTCNTCL+WDTSSEL+WDTIS0)
+#define WDT_ADLY_16        (WDTPW+WDTTMSEL+WDTCNTCL+WDTSSEL+WDTIS1)
+#define WDT_ADLY_1_9       (WDTPW+WDTTMSEL+WDTCNTCL+WDTSSEL+WDTIS1+WDTIS0)
+
+/*
+ *  Hardware multiplier
+ */
+#define MPY                SFR16(0x0130)
+#define MPYS               SFR16(0x0132)
+#define MAC                SFR16(0x0134)
+#define MACS               SFR16(0x0136)
+#define OP2                SFR16(0x0138)
+#define RESLO              SFR16(0x013A)
+#define RESHI              SFR16(0x013C)
+#define SUMEXT             SFR16(0x013E)
+
+/*
+ *  Flash controller
+ */
+#define FCTL1              SFR16(0x0128)
+#define FCTL2              SFR16(0x012A)
+#define FCTL3              SFR16(0x012C)
+
+#define FRKEY              0x9600
+#define FWKEY              0xA500
+#define FXKEY              0x3300
+
+#define ERASE              0x0002
+#define MERAS              0x0004
+#define WRT                0x0040
+#define BLKWRT             0x0080
+#define SEGWRT             BLKWRT
+
+#define FN0                0x0001
+#define FN1                0x0002
+#define FN2                0x0004
+#define FN3                0x0008
+#define FN4                0x0010
+#define FN5                0x0020
+#define FSSEL_0            0x0000
+#define FSSEL_1            0x0040
+#define FSSEL_2            0x0080
+#define FSSEL_3            0x00C0
+
+#define BUSY               0x0001
+#define KEYV               0x0002
+#define ACCVIFG            0x0004
+#define WAIT               0x0008
+#define LOCK               0x0010
+#define EMEX               0x0020
+
+/*
+ *  USART 0 / 1
+ */
+#define U0CTL              SFR8(0x0070)
+#define U0TCTL             SFR8(0x0071)
+#define U0RCTL             SFR8(0x0072)
+#define U0MCTL             SFR8(0x0073)
+#define U0BR0              SFR8(0x0074)
+#define U0BR1              SFR8(0x0075)
+#define U0RXBUF            SFR8(0x0076)
+#define U0TXBUF            SFR8(0x0077)
+#define UMCTL0             U0MCTL
+
+#define U1CTL              SFR8(0x0078)
+#define U1TCTL             SFR8(0x0079)
+#define U1RCTL             SFR8(0x007A)
+#define U1MCTL             SFR8(0x007B)
+#define U1BR0              SFR8(0x007C)
+#define U1BR1              SFR8(0x007D)
+#define U1RXBUF            SFR8(0x007E)
+#define U1TXBUF            SFR8(0x007F)
+#define UMCTL1             U1MCTL
+
+#define SWRST              0x01
+#define MM                 0x02
+#define SYNC               0x04
+#define LISTEN             0x08
+#define CHAR               0x10
+#define SPB                0x20
+#define PEV                0x40
+#define PENA               0x80
+
+#define TXEPT              0x01
+#define STC                0x02
+#define TXWAKE             0x04
+#define URXSE              0x08
+#define SSEL0              0x10
+#define SSEL1              0x20
+#define CKPL               0x40
+#define CKPH               0x80
+
+/*
+ *  Timer A3
+ */
+#define TAIV               SFR16(0x012E)
+#define TACTL              SFR16(0x0160)
+#define TACCTL0            SFR16(0x0162)
+#define TACCTL1            SFR16(0x0164)
+#define TACCTL2            SFR16(0x0166)
+#define TAR                SFR16(0x0170)
+#define TACCR0             SFR16(0x0172)
+#define TACCR1             SFR16(0x0174)
+#define TACCR2             SFR16(0x0176)
+#define CCTL0              TACCTL0
+#define CCTL1              TACCTL1
+#define CCTL2              TACCTL2
+#define CCR0               TACCR0
+#define CCR1               TACCR1
+#define CCR2               TACCR2
+
+#define TAIFG              0x0001
+#define TAIE               0x0002
+#define TACLR              0x0004
+#define MC_0               0x0000
+#define MC_1               0x0010
+#define MC_2               0x0020
+#define MC_3               0x0030
+#define ID_0               0x0000
+#define ID_1               0x0040
+#define ID_2               0x0080
+#define ID_3               0x00C0
+#define TASSEL_0           0x0000
+#define TASSEL_1           0x0100
+#define TASSEL_2           0x0200
+#define TASSEL_3           0x0300
+
+#define CCIFG              0x0001
+#define COV                0x0002
+#define OUT                0x0004
+#define CCI                0x0008
+#define CCIE               0x0010
+#define OUTMOD_0           0x0000
+#define OUTMOD_1           0x0020
+#define OUTMOD_2           0x0040
+#define OUTMOD_3           0x0060
+#define OUTMOD_4           0x0080
+#define OUTMOD_5           0x00A0
+#define OUTMOD_6           0x00C0
+#define OUTMOD_7           0x00E0
+#define CAP                0x0100
+#define SCCI               0x0400
+#define SCS                0x0800
+#define CCIS_0             0x0000
+#define CCIS_1             0x1000
+#define CCIS_2             0x2000
+#define CCIS_3             0x3000
+#define CM_0               0x0000
+#define CM_1               0x4000
+#define CM_2               0x8000
+#define CM_3               0xC000
+
+#define TAIV_NONE          0x0000
+#define TAIV_TACCR1        0x0002
+#define TAIV_TACCR2        0x0004
+#define TAIV_TAIFG         0x000A
+
+/*
+ *  Timer B7
+ */
+#define TBIV               SFR16(0x011E)
+#define TBCTL              SFR16(0x0180)
+#define TBCCTL0            SFR16(0x0182)
+#define TBCCTL1            SFR16(0x0184)
+#define TBCCTL2            SFR16(0x0186)
+#define TBCCTL3            SFR16(0x0188)
+#define TBCCTL4            SFR16(0x018A)
+#define TBCCTL5            SFR16(0x018C)
+#define TBCCTL6            SFR16(0x018E)
+#define TBR                SFR16(0x0190)
+#define TBCCR0             SFR16(0x0192)
+#define TBCCR1             SFR16(0x0194)
+#define TBCCR2             SFR16(0x0196)
+#define TBCCR3             SFR16(0x0198)
+#define TBCCR4             SFR16(0x019A)
+#define TBCCR5             SFR16(0x019C)
+#define TBCCR6             SFR16(0x019E)
+
+#define TBIFG              0x0001
+#define TBIE               0x0002
+#define TBCLR              0x0004
+#define TBSSEL_0           0x0000
+#define TBSSEL_1           0x0100
+#define TBSSEL_2           0x0200
+#define TBSSEL_3           0x0300
+#define CNTL_0             0x0000
+#define TBCLGRP_0          0x0000
+
+#define TBIV_NONE          0x0000
+#define TBIV_TBCCR1        0x0002
+#define TBIV_TBCCR2        0x0004
+#define TBIV_TBIFG         0x000E
+
+/*
+ *  Interrupt vectors (mspgcc numbering)
+ */
+#define DACDMA_VECTOR      0
+#define PORT2_VECTOR       2
+#define USART1TX_VECTOR    4
+#define USART1RX_VECTOR    6
+#define PORT1_VECTOR       8
+#define TIMERA1_VECTOR     10
+#define TIMERA0_VECTOR     12
+#define ADC12_VECTOR       14
+#define USART0TX_VECTOR    16
+#define USART0RX_VECTOR    18
+#define WDT_VECTOR         20
+#define COMPARATORA_VECTOR 22
+#define TIMERB1_VECTOR     24
+#define TIMERB0_VECTOR     26
+#define NMI_VECTOR         28
+
+#define UART0TX_VECTOR     USART0TX_VECTOR
+#define UART0RX_VECTOR     USART0RX_VECTOR
+#define UART1TX_VECTOR     USART1TX_VECTOR
+#define UART1RX_VECTOR     USART1RX_VECTOR
+
+#endif
@@ -0,0 +1,84 @@
+#!/bin/sh
+#
+#  @file optreport.sh
+#  @author TheFwGuy
+#  @version 1.0
+#  @date October 2026
+#  @brief Comparison of the firmware built at every optimization level
+#
+#  Host build : the bench and a firmware run are repeated at every level and
+#  compared with -O0. The simulator charges the time per register access, so
+#  a correct build gives the same results at any level.
+#  Target build (msp430-gcc needed) : image size and static cycle count of
+#  the hot paths (see cycles.awk) at every level.
+#
+#  Run from the top directory with 'make optreport'.
+#
+
+LEVELS="-O0 -Os -O2"
+HOT="Timer_A Timer_A1 PORT1_ISR WDT_ISR USART0TX_ISR RpmRead RpmGateTenths LCDFmtNum"
+SCENARIO="SIM_TIME=6 SIM_RPM=1200 SIM_KEYS=0.5:down,1.0:push"
+
+status=0
+
+echo "Host build, results against -O0"
+for opt in $LEVELS
+do
+   dir=hostbuild$opt
+   make -s OPT=$opt HOSTDIR=$dir $dir/bench $dir/rpm_host || exit 1
+
+   start=$(date +%s%N)
+   ./$dir/bench -c > $dir/bench.csv
+   end=$(date +%s%N)
+   env $SCENARIO ./$dir/rpm_host > $dir/run.txt
+
+   if [ $opt = -O0 ]
+   then
+      result="reference"
+   elif cmp -s hostbuild-O0/bench.csv $dir/bench.csv && \
+        cmp -s hostbuild-O0/run.txt $dir/run.txt
+   then
+      result="identical"
+   else
+      result="DIFFERENT"
+      status=1
+   fi
+   printf "  %-4s bench %6d ms  %s\n" $opt $(( (end - start) / 1000000 )) $result
+done
+
+if ! command -v msp430-gcc > /dev/null 2>&1
+then
+   echo "msp430-gcc not found, target size and cycles skipped"
+   exit $status
+fi
+
+echo
+echo "Target image (msp430-size)"
+echo "        text   data    bss"
+for opt in $LEVELS
+do
+   dir=build$opt
+   make -s OPT=$opt TGTDIR=$dir/ all || exit 1
+   msp430-size $dir/rpm.elf | awk -v opt=$opt 'NR == 2 { printf "  %-4s %6d %6d %6d\n", opt, $1, $2, $3 }'
+   msp430-objdump -d $dir/rpm.elf | awk -v hot="$HOT" -f host/cycles.awk > $dir/cycles.txt
+done
+
+echo
+echo "Hot paths, instructions / bytes / static cycles"
+printf "  %-16s" "function"
+for opt in $LEVELS
+do
+   printf " %18s" $opt
+done
+echo
+for fn in $HOT
+do
+   printf "  %-16s" $fn
+   for opt in $LEVELS
+   do
+      awk -v fn=$fn '$1 == fn { printf " %5d %5d %6d", $2, $3, $4 }' build$opt/cycles.txt
+   done
+   echo
+done
+
+exit $status
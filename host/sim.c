@@ -0,0 +1,1394 @@
+/**
+ *  @file sim.c
+ *  @author TheFwGuy
+ *  @version 1.0
+ *  @date October 2026
+ *  @brief MSP430F169 peripheral model used by the host build
+ *
+ *  The model is event driven: the time advances by a few MCLK cycles at
+ *  every register access, or jumps to the next peripheral event while the
+ *  CPU sleeps in a low power mode. Timers are counted on an absolute
+ *  clock grid, so the ACLK based timing is exact.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "sim.h"
+#include "msp430_sim.h"
+
+#define ACCESS_CYCLES    4        /* MCLK cycles charged for each register access */
+#define ISR_CYCLES       11       /* interrupt entry (6) + reti (5) */
+#define LFXT1_HZ         32768.0
+#define XT2_HZ           8000000.0
+#define LFXT1_SETTLE     0.25     /* oscillator fault flag cleared after 250 ms */
+#define NEVER            1e30
+#define MAX_PINEVT       64
+#define FLASH_START      0x1000   /* information memory, then main memory */
+#define MAIN_START       0x1100
+#define FTG_MIN          257000.0 /* flash timing generator range */
+#define FTG_MAX          476000.0
+#define FTG_WRITE        35       /* byte program, FTG cycles */
+#define FTG_ERASE        4819     /* segment erase, FTG cycles */
+#define ISR_DEPTH        8
+
+/*
+ *  Supply current (MSP430F169 datasheet, typical at 3 V). The active and
+ *  LPM0 currents grow with the clock, the crystal and ACLK are always on.
+ */
+#define VCC              3.0
+#define I_ACLK           1.6e-6   /* LPM3 */
+#define I_AM_HZ          500e-12  /* active, per MCLK Hz (500 uA at 1 MHz) */
+#define I_LPM0_HZ        55e-12   /* LPM0/LPM1, per DCO Hz (55 uA at 1 MHz) */
+#define I_LPM2           17e-6
+#define I_LPM4           0.1e-6
+#define I_FLASH          3e-3     /* program or erase, on top of the CPU */
+
+/*
+ *  Interrupt service routines of the firmware.
+ *  Weak, so a host tool can link only part of the application.
+ */
+extern void PORT2_ISR(void)    __attribute__((weak));
+extern void USART1TX_ISR(void) __attribute__((weak));
+extern void PORT1_ISR(void)    __attribute__((weak));
+extern void Timer_A1(void)     __attribute__((weak));
+extern void Timer_A(void)      __attribute__((weak));
+extern void USART0TX_ISR(void) __attribute__((weak));
+extern void WDT_ISR(void)      __attribute__((weak));
+extern void Timer_B1(void)     __attribute__((weak));
+
+static void (*Vectors[SIM_NUM_VECTORS])(void);
+
+/* Dispatch order, highest priority first */
+static const int Priority[] =
+{
+   TIMERB0_VECTOR, TIMERB1_VECTOR, COMPARATORA_VECTOR, WDT_VECTOR,
+   USART0RX_VECTOR, USART0TX_VECTOR, ADC12_VECTOR, TIMERA0_VECTOR,
+   TIMERA1_VECTOR, PORT1_VECTOR, USART1RX_VECTOR, USART1TX_VECTOR,
+   PORT2_VECTOR, DACDMA_VECTOR
+};
+
+/*
+ *  Timer model (Timer_A3 and Timer_B7 share it)
+ */
+typedef struct
+{
+   unsigned int ctl, r, iv;      /* register addresses */
+   unsigned int cctl0, ccr0;     /* first capture/compare pair */
+   int          nccr;
+   int          clkport, clkbit; /* external clock pin */
+   unsigned short cfg;           /* clock related bits in use */
+   double       f;               /* tick rate, 0 = stopped or external */
+   double       epoch;
+   unsigned long long k;         /* ticks since epoch */
+} Tmr;
+
+static Tmr TA = { 0x0160, 0x0170, 0x012E, 0x0162, 0x0172, 3, 1, 0 };
+static Tmr TB = { 0x0180, 0x0190, 0x011E, 0x0182, 0x0192, 7, 4, 7 };
+
+/*
+ *  Simulator state
+ */
+static unsigned char Mem[0x10000];
+static unsigned char Ext[7];             /* level driven on the pins from outside */
+static double  Now;
+static double  EndTime = NEVER;
+static sim_end_fn EndFn;
+static unsigned short Sr;
+static unsigned short SrStack[ISR_DEPTH];
+static int     IsrDepth;
+static int     InAdvance;
+static unsigned long IsrCount[SIM_NUM_VECTORS];
+static sim_hook_fn IsrHook;
+static unsigned long long Cycles;
+static double  ActiveTime, SleepTime;
+static double  Charge;                   /* drawn from the supply, coulomb */
+static double  Dco, Mclk, Smclk, Aclk;
+
+static sim_wave_fn HallFn;
+static void   *HallCtx;
+static double  HallNext = NEVER;
+static int     HallLevel;
+
+static struct { double t; int port, bit, level; } PinEvt[MAX_PINEVT];
+static int     NumPinEvt;
+
+/* Pending writes, committed at the next simulator step */
+static int     TxPending;
+static int     Tx1Pending;
+static int     Op2Pending;
+static unsigned int MpyMode;
+
+/* USART0 SPI */
+static int     SpiShifting, SpiBufFull;
+static unsigned char SpiShift, SpiBuf;
+static double  SpiEnd = NEVER;
+
+/* USART1 UART transmitter */
+static int     UartShifting, UartBufFull;
+static unsigned char UartShift, UartBuf;
+static double  UartEnd = NEVER;
+static sim_byte_fn UartFn;
+static void   *UartCtx;
+static unsigned long UartBytes;
+
+/* Flash controller */
+static int     FlashPending;
+static unsigned int FlashAddr;
+static unsigned short FlashMode;
+static unsigned char FlashLatch;
+static int     FlashHold;                /* CPU held by a flash operation */
+static unsigned long FlashWrites, FlashErrors;
+static unsigned long FlashErases[0x10000 >> 7];
+
+/* Watchdog interval timer */
+static unsigned short WdtCfg;
+static double  WdtEpoch, WdtPeriod;
+
+/* PCD8544 */
+static unsigned char LcdRam[6][84];
+static int     LcdX, LcdY, LcdH;
+static unsigned long LcdBytes;
+static double  LcdLast;
+
+static void Advance(double target);
+static void Dispatch(void);
+
+/*
+ *  Register helpers
+ */
+static unsigned short Rd16(unsigned int a) { return Mem[a] | (Mem[a + 1] << 8); }
+static void Wr16(unsigned int a, unsigned short v) { Mem[a] = v & 0xFF; Mem[a + 1] = v >> 8; }
+static unsigned int PortIn(int port)
+{
+   static const unsigned int base[7] = { 0, 0x20, 0x28, 0x18, 0x1C, 0x30, 0x34 };
+   return base[port];
+}
+static unsigned int PortOut(int port) { return PortIn(port) + 1; }
+static unsigned int PortDir(int port) { return PortIn(port) + 2; }
+static unsigned int PortSel(int port) { return port <= 2 ? PortIn(port) + 6 : PortIn(port) + 3; }
+
+static unsigned char PinLevels(int port)
+{
+   unsigned char dir = Mem[PortDir(port)];
+
+   return (Ext[port] & ~dir) | (Mem[PortOut(port)] & dir);
+}
+
+/*
+ *  Clocks
+ */
+static double DcoHz(void)
+{
+   unsigned char dcoctl = Mem[0x56];
+   int    rsel = Mem[0x57] & 0x07;
+   int    dco  = dcoctl >> 5;
+   int    mod  = dcoctl & 0x1F;
+   double f0, f1;
+
+   /* ~800kHz at RSEL=7 DCO=3, as set up by InitFreq */
+   f0 = 800000.0 * pow(1.6, rsel - 7) * pow(1.12, dco - 3);
+   f1 = (dco < 7) ? f0 * 1.12 : f0;
+   return (f0 * (32 - mod) + f1 * mod) / 32.0;
+}
+
+static void UpdateClocks(void)
+{
+   unsigned char bcs1 = Mem[0x57];
+   unsigned char bcs2 = Mem[0x58];
+   double xt2 = (bcs1 & XT2OFF) ? 0.0 : XT2_HZ;
+   double src;
+
+   Dco  = DcoHz();
+   Aclk = LFXT1_HZ / (1 << ((bcs1 >> 4) & 3));
+
+   switch(bcs2 & 0xC0)
+   {
+      case SELM_2: src = xt2 ? xt2 : Dco; break;
+      case SELM_3: src = LFXT1_HZ;        break;
+      default:     src = Dco;             break;
+   }
+   Mclk = src / (1 << ((bcs2 >> 4) & 3));
+
+   src = ((bcs2 & SELS) && xt2) ? xt2 : Dco;
+   Smclk = src / (1 << ((bcs2 >> 1) & 3));
+}
+
+/*
+ *  Timers
+ */
+static double TmrRate(Tmr *t, unsigned short ctl)
+{
+   double src;
+
+   if((ctl & MC_3) == MC_0)
+      return 0.0;
+
+   switch(ctl & TASSEL_3)
+   {
+      case TASSEL_1: src = Aclk;  break;
+      case TASSEL_2: src = Smclk; break;
+      default:       return 0.0;           /* external TxCLK / INCLK */
+   }
+   return src / (1 << ((ctl >> 6) & 3));
+}
+
+static unsigned short Ccr(Tmr *t, int n)   { return Rd16(t->ccr0 + 2 * n); }
+static unsigned short Cctl(Tmr *t, int n)  { return Rd16(t->cctl0 + 2 * n); }
+
+/* Ticks from now to the next flag setting event of the timer */
+static unsigned long TmrNextTicks(Tmr *t)
+{
+   unsigned short ctl = Rd16(t->ctl);
+   unsigned long  r   = Rd16(t->r);
+   unsigned long  best, n, top, c;
+   int i;
+
+   if((ctl & MC_3) == MC_2)
+   {
+      best = 0x10000 - r;
+      for(i = 0; i < t->nccr; i++)
+      {
+         if(Cctl(t, i) & CAP)
+            continue;
+         n = (Ccr(t, i) - r) & 0xFFFF;
+         if(n == 0) n = 0x10000;
+         if(n < best) best = n;
+      }
+      return best;
+   }
+
+   /* Up mode (up/down is approximated as up) */
+   top  = Ccr(t, 0);
+   if(r > top) r = top;
+   best = top - r + 1;
+   for(i = 0; i < t->nccr; i++)
+   {
+      if(Cctl(t, i) & CAP)
+         continue;
+      c = Ccr(t, i);
+      if(c > top)
+         continue;
+      n = (c > r) ? c - r : c + top + 1 - r;
+      if(n < best) best = n;
+   }
+   return best;
+}
+
+/* Advance the counter by n ticks; n never crosses more than one event */
+static void TmrStep(Tmr *t, unsigned long n)
+{
+   unsigned short ctl = Rd16(t->ctl);
+   unsigned long  r   = Rd16(t->r);
+   unsigned long  top;
+   int i;
+
+   if(n == 0)
+      return;
+
+   if((ctl & MC_3) == MC_2)
+   {
+      r = (r + n) & 0xFFFF;
+      if(r == 0)
+         Wr16(t->ctl, Rd16(t->ctl) | TAIFG);
+   }
+   else
+   {
+      top = Ccr(t, 0);
+      r += n;
+      if(r > top)
+      {
+         r = 0;
+         Wr16(t->ctl, Rd16(t->ctl) | TAIFG);
+      }
+   }
+   Wr16(t->r, r);
+
+   for(i = 0; i < t->nccr; i++)
+   {
+      unsigned short cc = Cctl(t, i);
+
+      if(!(cc & CAP) && Ccr(t, i) == r)
+         Wr16(t->cctl0 + 2 * i, cc | CCIFG);
+   }
+}
+
+static void TmrTicks(Tmr *t, unsigned long long due)
+{
+   unsigned long n;
+
+   while(due > 0)
+   {
+      n = TmrNextTicks(t);
+      if(due >= n)
+      {
+         TmrStep(t, n);
+         due -= n;
+      }
+      else
+      {
+         /* No event on the way: just move the counter */
+         unsigned short ctl = Rd16(t->ctl);
+         unsigned long r = Rd16(t->r) + (unsigned long)due;
+
+         if((ctl & MC_3) == MC_2)
+            r &= 0xFFFF;
+         Wr16(t->r, r);
+         due = 0;
+      }
+   }
+}
+
+static void TmrSync(Tmr *t, double when)
+{
+   unsigned long long target;
+
+   if(t->f <= 0.0)
+      return;
+   target = (unsigned long long)floor((when - t->epoch) * t->f + 1e-6);
+   if(target > t->k)
+   {
+      TmrTicks(t, target - t->k);
+      t->k = target;
+   }
+}
+
+/* Pick up configuration changes made by the firmware */
+static void TmrConfig(Tmr *t)
+{
+   unsigned short ctl = Rd16(t->ctl);
+   unsigned short cfg = ctl & (TASSEL_3 | ID_3 | MC_3);
+   double f = TmrRate(t, ctl);
+
+   if(ctl & TACLR)
+   {
+      Wr16(t->r, 0);
+      Wr16(t->ctl, ctl & ~TACLR);
+   }
+
+   if(cfg != t->cfg || f != t->f)
+   {
+      t->cfg   = cfg;
+      t->f     = f;
+      t->k     = 0;
+      t->epoch = (f > 0.0) ? floor(Now * f + 1e-6) / f : Now;
+   }
+}
+
+static double TmrNextTime(Tmr *t)
+{
+   if(t->f <= 0.0)
+      return NEVER;
+   return t->epoch + (double)(t->k + TmrNextTicks(t)) / t->f;
+}
+
+/* Capture on a pin edge, if the pin feeds a capture input */
+static void TmrCapture(Tmr *t, int port, int bit, int rising)
+{
+   int n, first;
+   unsigned short cc, cm;
+
+   /* Timer_A: CCI0A-CCI2A on P1.1-P1.3, Timer_B: CCI0A-CCI6A on P4.0-P4.6 */
+   if(t == &TA) { if(port != 1) return; first = 1; }
+   else         { if(port != 4) return; first = 0; }
+
+   n = bit - first;
+   if(n < 0 || n >= t->nccr)
+      return;
+   if(!(Mem[PortSel(port)] & (1 << bit)))
+      return;
+
+   cc = Cctl(t, n);
+   if(!(cc & CAP) || (cc & CCIS_3) != CCIS_0)
+      return;
+   cm = cc & CM_3;
+   if(!((cm & CM_1) && rising) && !((cm & CM_2) && !rising))
+      return;
+
+   TmrSync(t, Now);
+   Wr16(t->ccr0 + 2 * n, Rd16(t->r));
+   if(cc & CCIFG)
+      cc |= COV;
+   Wr16(t->cctl0 + 2 * n, cc | CCIFG);
+}
+
+/* One tick from the external clock pin */
+static void TmrExtClock(Tmr *t, int port, int bit, int rising)
+{
+   unsigned short ctl = Rd16(t->ctl);
+
+   if(!rising || port != t->clkport || bit != t->clkbit)
+      return;
+   if(!(Mem[PortSel(port)] & (1 << bit)))
+      return;
+   if((ctl & MC_3) == MC_0 || (ctl & TASSEL_3) != TASSEL_0)
+      return;
+   TmrTicks(t, 1);
+}
+
+/*
+ *  Pins
+ */
+static void PinChange(int port, int bit, int level)
+{
+   unsigned char mask = 1 << bit;
+   unsigned char before = PinLevels(port);
+   unsigned char after;
+   int rising;
+
+   if(level) Ext[port] |= mask;
+   else      Ext[port] &= ~mask;
+
+   after = PinLevels(port);
+   if((before ^ after) & mask)
+   {
+      rising = (after & mask) != 0;
+
+      if(port <= 2)
+      {
+         unsigned int ies = PortIn(port) + 4;
+         unsigned int ifg = PortIn(port) + 3;
+
+         if(rising != ((Mem[ies] & mask) != 0))
+            Mem[ifg] |= mask;
+      }
+
+      TmrCapture(&TA, port, bit, rising);
+      TmrCapture(&TB, port, bit, rising);
+      TmrExtClock(&TA, port, bit, rising);
+      TmrExtClock(&TB, port, bit, rising);
+   }
+}
+
+void sim_pin(int port, int bit, int level)
+{
+   PinChange(port, bit, level);
+   Dispatch();
+}
+
+void sim_schedule_pin(double t, int port, int bit, int level)
+{
+   int i;
+
+   if(NumPinEvt >= MAX_PINEVT)
+      return;
+
+   /* Keep the list sorted by time */
+   for(i = NumPinEvt; i > 0 && PinEvt[i - 1].t > t; i--)
+      PinEvt[i] = PinEvt[i - 1];
+   PinEvt[i].t     = t;
+   PinEvt[i].port  = port;
+   PinEvt[i].bit   = bit;
+   PinEvt[i].level = level;
+   NumPinEvt++;
+}
+
+void sim_set_hall(sim_wave_fn fn, void *ctx)
+{
+   HallFn  = fn;
+   HallCtx = ctx;
+   HallNext = fn ? fn(ctx, &HallLevel) : NEVER;
+}
+
+/*
+ *  PCD8544
+ */
+static void LcdReceive(unsigned char b, int data)
+{
+   LcdBytes++;
+   LcdLast = Now;
+
+   if(data)
+   {
+      LcdRam[LcdY][LcdX] = b;
+      if(++LcdX >= 84)
+      {
+         LcdX = 0;
+         if(++LcdY >= 6)
+            LcdY = 0;
+      }
+      return;
+   }
+
+   if((b & 0xF8) == 0x20)
+      LcdH = b & 0x01;
+   else if(!LcdH && (b & 0x80))
+      LcdX = (b & 0x7F) % 84;
+   else if(!LcdH && (b & 0xF8) == 0x40)
+      LcdY = (b & 0x07) % 6;
+}
+
+/*
+ *  USART0 in SPI master mode
+ */
+static double SpiByteTime(void)
+{
+   unsigned int br = Mem[0x74] | (Mem[0x75] << 8);
+
+   if(br < 2) br = 2;
+   return 8.0 * br / Smclk;
+}
+
+static void SpiCommit(unsigned char b)
+{
+   if(Mem[0x70] & SWRST)
+      return;
+
+   Mem[0x02] &= ~UTXIFG0;
+   if(!SpiShifting)
+   {
+      SpiShifting = 1;
+      SpiShift    = b;
+      SpiEnd      = Now + SpiByteTime();
+      Mem[0x02]  |= UTXIFG0;
+      Mem[0x71]  &= ~TXEPT;
+   }
+   else
+   {
+      SpiBufFull = 1;
+      SpiBuf     = b;
+   }
+}
+
+static void SpiDone(void)
+{
+   unsigned char p3 = Mem[0x19] | ~Mem[0x1A];
+
+   /* CE on P3.0 (active low), D/C on P3.2 */
+   if(!(p3 & 0x01))
+      LcdReceive(SpiShift, (p3 & 0x04) != 0);
+
+   if(SpiBufFull)
+   {
+      SpiBufFull = 0;
+      SpiShift   = SpiBuf;
+      SpiEnd     = Now + SpiByteTime();
+      Mem[0x02] |= UTXIFG0;
+   }
+   else
+   {
+      SpiShifting = 0;
+      SpiEnd      = NEVER;
+      Mem[0x71]  |= TXEPT;
+   }
+}
+
+/*
+ *  USART1 in UART mode (transmitter only)
+ */
+static double UartByteTime(void)
+{
+   unsigned char ctl  = Mem[0x78];
+   unsigned char mctl = Mem[0x7B];
+   unsigned int  br   = Mem[0x7C] | (Mem[0x7D] << 8);
+   double clk, bits;
+   int    mod = 0;
+
+   switch(Mem[0x79] & (SSEL1 | SSEL0))
+   {
+      case SSEL0: clk = Aclk;  break;
+      case 0:     return NEVER;            /* external UCLKI, not modelled */
+      default:    clk = Smclk; break;
+   }
+   if(br < 3) br = 3;
+   for(; mctl; mctl >>= 1)
+      mod += mctl & 1;
+
+   /* Start, data, parity and stop bits */
+   bits = 1 + ((ctl & CHAR) ? 8 : 7) + ((ctl & PENA) ? 1 : 0) + ((ctl & SPB) ? 2 : 1);
+   return bits * (br + mod / 8.0) / clk;
+}
+
+static void UartCommit(unsigned char b)
+{
+   if((Mem[0x78] & SWRST) || !(Mem[0x05] & UTXE1))
+      return;
+
+   Mem[0x03] &= ~UTXIFG1;
+   if(!UartShifting)
+   {
+      UartShifting = 1;
+      UartShift    = b;
+      UartEnd      = Now + UartByteTime();
+      Mem[0x03]   |= UTXIFG1;
+      Mem[0x79]   &= ~TXEPT;
+   }
+   else
+   {
+      UartBufFull = 1;
+      UartBuf     = b;
+   }
+}
+
+static void UartDone(void)
+{
+   UartBytes++;
+   if(UartFn)
+      UartFn(UartCtx, UartShift);
+
+   if(UartBufFull)
+   {
+      UartBufFull = 0;
+      UartShift   = UartBuf;
+      UartEnd     = Now + UartByteTime();
+      Mem[0x03]  |= UTXIFG1;
+   }
+   else
+   {
+      UartShifting = 0;
+      UartEnd      = NEVER;
+      Mem[0x79]   |= TXEPT;
+   }
+}
+
+/*
+ *  Flash controller.
+ *  The firmware runs from flash, so the CPU is held (no interrupt served)
+ *  for the whole byte program or segment erase.
+ */
+static double FlashClock(void)
+{
+   unsigned short ctl2 = Rd16(0x012A);
+   double src;
+
+   switch(ctl2 & FSSEL_3)
+   {
+      case FSSEL_0: src = Aclk;  break;
+      case FSSEL_1: src = Mclk;  break;
+      default:      src = Smclk; break;
+   }
+   return src / ((ctl2 & 0x3F) + 1);
+}
+
+static void FlashCommit(void)
+{
+   double ftg = FlashClock();
+   unsigned int size, base;
+   double t;
+
+   FlashPending = 0;
+   if((Rd16(0x012C) & LOCK) || FlashAddr < FLASH_START)
+   {
+      Mem[0x012C] |= ACCVIFG;
+      FlashErrors++;
+      return;
+   }
+   if(ftg < FTG_MIN || ftg > FTG_MAX)
+      FlashErrors++;
+
+   if(FlashMode & ERASE)
+   {
+      /* 128 byte information segments, 512 byte main segments (the first one is 256) */
+      size = FlashAddr < MAIN_START ? 128 : 512;
+      base = FlashAddr & ~(size - 1);
+      if(size == 512 && base < MAIN_START)
+      {
+         base = MAIN_START;
+         size = 256;
+      }
+      memset(&Mem[base], 0xFF, size);
+      FlashErases[base >> 7]++;
+      t = FTG_ERASE / ftg;
+   }
+   else
+   {
+      /* Programming can only clear bits */
+      if((Mem[FlashAddr] & FlashLatch) != FlashLatch)
+         FlashErrors++;
+      Mem[FlashAddr] &= FlashLatch;
+      FlashWrites++;
+      t = FTG_WRITE / ftg;
+   }
+
+   FlashHold = 1;
+   Advance(Now + t);
+   FlashHold = 0;
+}
+
+/*
+ *  Hardware multiplier
+ */
+static void MpyCommit(void)
+{
+   unsigned long op1 = Rd16(MpyMode);
+   unsigned long op2 = Rd16(0x0138);
+   unsigned long long acc;
+   long long sres;
+
+   switch(MpyMode)
+   {
+      case 0x0132:   /* MPYS */
+         sres = (long long)(short)op1 * (short)op2;
+         Wr16(0x013A, sres & 0xFFFF);
+         Wr16(0x013C, (sres >> 16) & 0xFFFF);
+         Wr16(0x013E, sres < 0 ? 0xFFFF : 0);
+         break;
+
+      case 0x0134:   /* MAC */
+         acc = ((unsigned long long)Rd16(0x013C) << 16 | Rd16(0x013A)) + op1 * op2;
+         Wr16(0x013A, acc & 0xFFFF);
+         Wr16(0x013C, (acc >> 16) & 0xFFFF);
+         Wr16(0x013E, (acc >> 32) ? 1 : 0);
+         break;
+
+      default:       /* MPY */
+         acc = op1 * op2;
+         Wr16(0x013A, acc & 0xFFFF);
+         Wr16(0x013C, (acc >> 16) & 0xFFFF);
+         Wr16(0x013E, 0);
+         break;
+   }
+}
+
+/*
+ *  Watchdog
+ */
+static void WdtConfig(void)
+{
+   unsigned short ctl = Rd16(0x0120) & 0xFF;
+   static const double div[4] = { 32768.0, 8192.0, 512.0, 64.0 };
+
+   if(ctl & WDTCNTCL)
+   {
+      ctl &= ~WDTCNTCL;
+      Wr16(0x0120, ctl);
+      WdtCfg = 0xFFFF;      /* force a restart */
+   }
+
+   if(ctl != WdtCfg)
+   {
+      WdtCfg   = ctl;
+      WdtEpoch = Now;
+      WdtPeriod = (ctl & WDTHOLD) ? 0.0 :
+                  div[ctl & 3] / ((ctl & WDTSSEL) ? Aclk : Smclk);
+   }
+}
+
+static double WdtNextTime(void)
+{
+   return (WdtPeriod > 0.0) ? WdtEpoch + WdtPeriod : NEVER;
+}
+
+static void WdtExpire(void)
+{
+   if(!(WdtCfg & WDTTMSEL))
+   {
+      fprintf(stderr, "sim: watchdog reset at %.6f s\n", Now);
+      exit(2);
+   }
+   Mem[0x02] |= WDTIFG;
+   WdtEpoch += WdtPeriod;
+}
+
+/*
+ *  Core
+ */
+static void Commit(void)
+{
+   if(TxPending)
+   {
+      TxPending = 0;
+      SpiCommit(Mem[0x77]);
+   }
+   if(Tx1Pending)
+   {
+      Tx1Pending = 0;
+      UartCommit(Mem[0x7F]);
+   }
+   if(Op2Pending)
+   {
+      Op2Pending = 0;
+      MpyCommit();
+   }
+
+   if(Mem[0x70] & SWRST)
+   {
+      SpiShifting = SpiBufFull = 0;
+      SpiEnd      = NEVER;
+      Mem[0x02]  |= UTXIFG0;
+      Mem[0x71]  |= TXEPT;
+   }
+   if(Mem[0x78] & SWRST)
+   {
+      UartShifting = UartBufFull = 0;
+      UartEnd      = NEVER;
+      Mem[0x03]   |= UTXIFG1;
+      Mem[0x79]   |= TXEPT;
+   }
+
+   UpdateClocks();
+   TmrConfig(&TA);
+   TmrConfig(&TB);
+   WdtConfig();
+
+   if(Now < LFXT1_SETTLE)
+      Mem[0x02] |= OFIFG;
+}
+
+static double NextEvent(void)
+{
+   double t = TmrNextTime(&TA);
+   double c;
+
+   if((c = TmrNextTime(&TB)) < t) t = c;
+   if(HallNext < t)               t = HallNext;
+   if(NumPinEvt && PinEvt[0].t < t) t = PinEvt[0].t;
+   if(SpiEnd < t)                 t = SpiEnd;
+   if(UartEnd < t)                t = UartEnd;
+   if((c = WdtNextTime()) < t)    t = c;
+   return t;
+}
+
+/* Supply current in the present power mode */
+static double Current(void)
+{
+   double i;
+
+   if(!(Sr & CPUOFF))
+      i = I_ACLK + I_AM_HZ * Mclk;
+   else if(Sr & OSCOFF)
+      i = I_LPM4;
+   else if(Sr & SCG1)
+      i = (Sr & SCG0) ? I_ACLK : I_LPM2;
+   else
+      i = I_ACLK + I_LPM0_HZ * Dco;
+
+   if(FlashHold)
+      i += I_FLASH;
+   return i;
+}
+
+static void Account(double t)
+{
+   double dt = t - Now;
+
+   if(dt <= 0.0)
+      return;
+   if(Sr & CPUOFF)
+      SleepTime += dt;
+   else
+      ActiveTime += dt;
+   Charge += Current() * dt;
+   TmrSync(&TA, t);
+   TmrSync(&TB, t);
+   Now = t;
+}
+
+static void FireEvents(void)
+{
+   int level;
+
+   while(HallNext <= Now)
+   {
+      level = HallLevel;
+      PinChange(1, 1, level);
+      PinChange(4, 7, level);
+      HallNext = HallFn ? HallFn(HallCtx, &HallLevel) : NEVER;
+   }
+
+   while(NumPinEvt && PinEvt[0].t <= Now)
+   {
+      PinChange(PinEvt[0].port, PinEvt[0].bit, PinEvt[0].level);
+      NumPinEvt--;
+      memmove(&PinEvt[0], &PinEvt[1], NumPinEvt * sizeof(PinEvt[0]));
+   }
+
+   if(SpiEnd <= Now)
+      SpiDone();
+
+   if(UartEnd <= Now)
+      UartDone();
+
+   if(WdtNextTime() <= Now)
+      WdtExpire();
+}
+
+static void Advance(double target)
+{
+   double t;
+
+   if(target > EndTime)
+      target = EndTime;
+
+   InAdvance++;
+   for(;;)
+   {
+      Commit();
+      t = NextEvent();
+      if(t > target)
+      {
+         if(target > Now)
+            Account(target);
+         break;
+      }
+      if(t > Now)
+         Account(t);
+      FireEvents();
+      Dispatch();
+   }
+   InAdvance--;
+
+   if(Now >= EndTime && IsrDepth == 0)
+   {
+      EndTime = NEVER;
+      if(EndFn)
+         EndFn();
+      exit(0);
+   }
+}
+
+/* Which flag a pending interrupt comes from, 0 if none */
+static int Pending(int vec)
+{
+   switch(vec)
+   {
+      case TIMERA0_VECTOR:
+         return (Cctl(&TA, 0) & (CCIE | CCIFG)) == (CCIE | CCIFG);
+      case TIMERA1_VECTOR:
+         return ((Cctl(&TA, 1) & (CCIE | CCIFG)) == (CCIE | CCIFG)) ||
+                ((Cctl(&TA, 2) & (CCIE | CCIFG)) == (CCIE | CCIFG)) ||
+                ((Rd16(TA.ctl) & (TAIE | TAIFG)) == (TAIE | TAIFG));
+      case TIMERB0_VECTOR:
+         return (Cctl(&TB, 0) & (CCIE | CCIFG)) == (CCIE | CCIFG);
+      case TIMERB1_VECTOR:
+      {
+         int i;
+         for(i = 1; i < TB.nccr; i++)
+            if((Cctl(&TB, i) & (CCIE | CCIFG)) == (CCIE | CCIFG))
+               return 1;
+         return (Rd16(TB.ctl) & (TBIE | TBIFG)) == (TBIE | TBIFG);
+      }
+      case PORT1_VECTOR:
+         return (Mem[0x23] & Mem[0x25]) != 0;
+      case PORT2_VECTOR:
+         return (Mem[0x2B] & Mem[0x2D]) != 0;
+      case WDT_VECTOR:
+         return (Mem[0x00] & Mem[0x02] & WDTIFG) != 0;
+      case USART0TX_VECTOR:
+         return (Mem[0x00] & Mem[0x02] & UTXIFG0) != 0;
+      case USART1TX_VECTOR:
+         return (Mem[0x01] & Mem[0x03] & UTXIFG1) != 0;
+      default:
+         return 0;
+   }
+}
+
+static void Dispatch(void)
+{
+   int i, vec;
+   int found;
+
+   while((Sr & GIE) && !FlashHold && IsrDepth < ISR_DEPTH)
+   {
+      found = 0;
+      for(i = 0; i < (int)(sizeof(Priority) / sizeof(Priority[0])); i++)
+      {
+         vec = Priority[i];
+         if(Pending(vec))
+         {
+            found = 1;
+            break;
+         }
+      }
+      if(!found)
+         return;
+
+      /* Single source flags are reset by the interrupt acceptance */
+      if(vec == TIMERA0_VECTOR) Wr16(TA.cctl0, Cctl(&TA, 0) & ~CCIFG);
+      if(vec == TIMERB0_VECTOR) Wr16(TB.cctl0, Cctl(&TB, 0) & ~CCIFG);
+      if(vec == WDT_VECTOR)     Mem[0x02] &= ~WDTIFG;
+      if(vec == USART0TX_VECTOR) Mem[0x02] &= ~UTXIFG0;
+      if(vec == USART1TX_VECTOR) Mem[0x03] &= ~UTXIFG1;
+
+      if(!Vectors[vec / 2])
+      {
+         fprintf(stderr, "sim: no handler for vector %d\n", vec);
+         exit(3);
+      }
+
+      SrStack[IsrDepth++] = Sr;
+      Sr &= ~(GIE | CPUOFF | OSCOFF | SCG0 | SCG1);
+      IsrCount[vec / 2]++;
+      Cycles += ISR_CYCLES;
+      Account(Now + ISR_CYCLES / Mclk);
+      Vectors[vec / 2]();
+      Commit();
+      Sr = SrStack[--IsrDepth];
+      if(IsrHook)
+         IsrHook(vec);
+   }
+}
+
+static void Step(void)
+{
+   if(FlashPending)
+      FlashCommit();
+   Cycles += ACCESS_CYCLES;
+   Advance(Now + ACCESS_CYCLES / Mclk);
+}
+
+/*
+ *  Register access entry points
+ */
+volatile unsigned char *sim_reg8(unsigned int addr)
+{
+   Step();
+
+   switch(addr)
+   {
+      case 0x20: case 0x28: case 0x18: case 0x1C: case 0x30: case 0x34:
+      {
+         int port;
+         for(port = 1; port <= 6; port++)
+            if(PortIn(port) == addr)
+               Mem[addr] = PinLevels(port);
+         break;
+      }
+      case 0x77:
+         TxPending = 1;
+         break;
+      case 0x7F:
+         Tx1Pending = 1;
+         break;
+   }
+   return &Mem[addr];
+}
+
+volatile unsigned short *sim_reg16(unsigned int addr)
+{
+   unsigned short v;
+   int i;
+
+   Step();
+
+   switch(addr)
+   {
+      case 0x0170:
+         TmrSync(&TA, Now);
+         break;
+
+      case 0x0190:
+         TmrSync(&TB, Now);
+         break;
+
+      case 0x012E:   /* TAIV: read clears the highest pending flag */
+         v = 0;
+         for(i = 1; i < TA.nccr && !v; i++)
+         {
+            if((Cctl(&TA, i) & (CCIE | CCIFG)) == (CCIE | CCIFG))
+            {
+               Wr16(TA.cctl0 + 2 * i, Cctl(&TA, i) & ~CCIFG);
+               v = 2 * i;
+            }
+         }
+         if(!v && (Rd16(TA.ctl) & (TAIE | TAIFG)) == (TAIE | TAIFG))
+         {
+            Wr16(TA.ctl, Rd16(TA.ctl) & ~TAIFG);
+            v = TAIV_TAIFG;
+         }
+         Wr16(addr, v);
+         break;
+
+      case 0x011E:   /* TBIV */
+         v = 0;
+         for(i = 1; i < TB.nccr && !v; i++)
+         {
+            if((Cctl(&TB, i) & (CCIE | CCIFG)) == (CCIE | CCIFG))
+            {
+               Wr16(TB.cctl0 + 2 * i, Cctl(&TB, i) & ~CCIFG);
+               v = 2 * i;
+            }
+         }
+         if(!v && (Rd16(TB.ctl) & (TBIE | TBIFG)) == (TBIE | TBIFG))
+         {
+            Wr16(TB.ctl, Rd16(TB.ctl) & ~TBIFG);
+            v = TBIV_TBIFG;
+         }
+         Wr16(addr, v);
+         break;
+
+      case 0x0130: case 0x0132: case 0x0134: case 0x0136:
+         MpyMode = addr;
+         break;
+
+      case 0x0138:
+         Op2Pending = 1;
+         break;
+   }
+   return (volatile unsigned short *)&Mem[addr];
+}
+
+/*
+ *  Flash memory access. While FCTL1 selects a write or an erase the byte
+ *  written goes to a latch and is programmed at the next access.
+ */
+volatile unsigned char *sim_flash8(unsigned int addr)
+{
+   unsigned short mode;
+
+   Step();
+
+   mode = Rd16(0x0128);
+   if(mode & (WRT | ERASE))
+   {
+      FlashPending = 1;
+      FlashAddr    = addr & 0xFFFF;
+      FlashMode    = mode;
+      FlashLatch   = Mem[FlashAddr];
+      return &FlashLatch;
+   }
+   return &Mem[addr & 0xFFFF];
+}
+
+/*
+ *  Status register
+ */
+void sim_bis_sr(unsigned short bits)
+{
+   double t;
+
+   Step();
+   Sr |= bits;
+   Dispatch();
+
+   /* Low power mode: sleep until an interrupt clears CPUOFF on exit */
+   while(Sr & CPUOFF)
+   {
+      Commit();
+      t = NextEvent();
+      if(t >= NEVER)
+         t = EndTime;
+      if(t >= NEVER)
+      {
+         fprintf(stderr, "sim: CPU asleep with no pending event\n");
+         exit(4);
+      }
+      Advance(t);
+   }
+}
+
+void sim_bic_sr(unsigned short bits)
+{
+   Step();
+   Sr &= ~bits;
+}
+
+void sim_bic_sr_irq(unsigned short bits)
+{
+   if(IsrDepth > 0)
+      SrStack[IsrDepth - 1] &= ~bits;
+}
+
+void sim_bis_sr_irq(unsigned short bits)
+{
+   if(IsrDepth > 0)
+      SrStack[IsrDepth - 1] |= bits;
+}
+
+unsigned short sim_read_sr(void)
+{
+   return Sr;
+}
+
+/*
+ *  Host side control
+ */
+void sim_reset(void)
+{
+   memset(Mem, 0, sizeof(Mem));
+   memset(Ext, 0xFF, sizeof(Ext));
+   Ext[1] &= ~0x02;               /* Hall input idle low */
+   Ext[4] &= ~0x80;
+
+   /* PUC values */
+   Mem[0x56] = 0x60;              /* DCOCTL */
+   Mem[0x57] = 0x84;              /* BCSCTL1: XT2OFF, RSEL=4 */
+   Mem[0x70] = SWRST;
+   Mem[0x71] = TXEPT;
+   Mem[0x02] = UTXIFG0 | OFIFG;
+   Mem[0x78] = SWRST;
+   Mem[0x79] = TXEPT;
+   Mem[0x03] = UTXIFG1;
+   memset(&Mem[FLASH_START], 0xFF, sizeof(Mem) - FLASH_START);   /* erased flash */
+   Wr16(0x0128, FRKEY);           /* FCTL1 */
+   Wr16(0x012A, FRKEY | 0x42);    /* FCTL2: MCLK / 3 */
+   Wr16(0x012C, FRKEY | LOCK | WAIT);
+   Wr16(0x0120, 0x0000);          /* watchdog running (as after reset) */
+   Wr16(0xFFFE, 0);
+
+   Now = 0.0;
+   EndTime = NEVER;
+   EndFn = NULL;
+   Sr = 0;
+   IsrDepth = 0;
+   memset(IsrCount, 0, sizeof(IsrCount));
+   Cycles = 0;
+   ActiveTime = SleepTime = 0.0;
+   Charge = 0.0;
+   HallFn = NULL;
+   HallNext = NEVER;
+   NumPinEvt = 0;
+   TxPending = Tx1Pending = Op2Pending = 0;
+   SpiShifting = SpiBufFull = 0;
+   SpiEnd = NEVER;
+   UartShifting = UartBufFull = 0;
+   UartEnd = NEVER;
+   UartBytes = 0;
+   FlashPending = FlashHold = 0;
+   FlashWrites = FlashErrors = 0;
+   memset(FlashErases, 0, sizeof(FlashErases));
+   WdtCfg = 0xFFFF;
+   memset(LcdRam, 0, sizeof(LcdRam));
+   LcdX = LcdY = LcdH = 0;
+   LcdBytes = 0;
+   LcdLast = 0.0;
+
+   TA.cfg = TB.cfg = 0;
+   TA.f = TB.f = 0.0;
+   TA.k = TB.k = 0;
+
+   Vectors[PORT2_VECTOR / 2]    = PORT2_ISR;
+   Vectors[USART1TX_VECTOR / 2] = USART1TX_ISR;
+   Vectors[PORT1_VECTOR / 2]    = PORT1_ISR;
+   Vectors[TIMERA1_VECTOR / 2]  = Timer_A1;
+   Vectors[TIMERA0_VECTOR / 2]  = Timer_A;
+   Vectors[USART0TX_VECTOR / 2] = USART0TX_ISR;
+   Vectors[WDT_VECTOR / 2]      = WDT_ISR;
+   Vectors[TIMERB1_VECTOR / 2]  = Timer_B1;
+
+   UpdateClocks();
+   WdtConfig();
+}
+
+double sim_time(void)
+{
+   return Now;
+}
+
+void sim_run_until(double t)
+{
+   Advance(t);
+}
+
+void sim_set_end(double t, sim_end_fn fn)
+{
+   EndTime = t;
+   EndFn   = fn;
+}
+
+void sim_set_isr_hook(sim_hook_fn fn)
+{
+   IsrHook = fn;
+}
+
+unsigned long sim_isr_count(int vector)
+{
+   return IsrCount[vector / 2];
+}
+
+unsigned long long sim_cycles(void)   { return Cycles; }
+double sim_active_time(void)          { return ActiveTime; }
+double sim_sleep_time(void)           { return SleepTime; }
+double sim_energy(void)               { return Charge * VCC; }
+double sim_mclk_hz(void)              { return Mclk; }
+double sim_smclk_hz(void)             { return Smclk; }
+double sim_aclk_hz(void)              { return Aclk; }
+unsigned long sim_lcd_bytes(void)     { return LcdBytes; }
+unsigned long sim_uart1_bytes(void)   { return UartBytes; }
+double sim_lcd_last_byte(void)        { return LcdLast; }
+
+unsigned char sim_lcd_ram(int bank, int x)
+{
+   return LcdRam[bank][x];
+}
+
+void sim_flash_read(unsigned int addr, unsigned char *buf, unsigned int len)
+{
+   memcpy(buf, &Mem[addr], len);
+}
+
+int sim_flash_load(const char *path)
+{
+   FILE *f = fopen(path, "rb");
+   size_t n;
+
+   if(!f)
+      return -1;
+   n = fread(&Mem[FLASH_START], 1, sizeof(Mem) - FLASH_START, f);
+   fclose(f);
+   return n == sizeof(Mem) - FLASH_START ? 0 : -1;
+}
+
+int sim_flash_save(const char *path)
+{
+   FILE *f = fopen(path, "wb");
+   size_t n;
+
+   if(!f)
+      return -1;
+   n = fwrite(&Mem[FLASH_START], 1, sizeof(Mem) - FLASH_START, f);
+   fclose(f);
+   return n == sizeof(Mem) - FLASH_START ? 0 : -1;
+}
+
+unsigned long sim_flash_writes(void)  { return FlashWrites; }
+unsigned long sim_flash_errors(void)  { return FlashErrors; }
+unsigned long sim_flash_erases(unsigned int addr) { return FlashErases[(addr & 0xFFFF) >> 7]; }
+
+void sim_set_uart1(sim_byte_fn fn, void *ctx)
+{
+   UartFn  = fn;
+   UartCtx = ctx;
+}
+
+/* Two pixel rows per text line */
+void sim_lcd_dump(FILE *f)
+{
+   int x, y, top, bot;
+
+   fprintf(f, "+------------------------------------------------------------------------------------+\n");
+   for(y = 0; y < 48; y += 2)
+   {
+      fputc('|', f);
+      for(x = 0; x < 84; x++)
+      {
+         top = (LcdRam[y / 8][x] >> (y % 8)) & 1;
+         bot = (LcdRam[(y + 1) / 8][x] >> ((y + 1) % 8)) & 1;
+         fputc(top ? (bot ? '#' : '"') : (bot ? '.' : ' '), f);
+      }
+      fputs("|\n", f);
+   }
+   fprintf(f, "+------------------------------------------------------------------------------------+\n");
+}
+
+void sim_report(FILE *f)
+{
+   static const char *name[SIM_NUM_VECTORS] =
+   {
+      "DACDMA", "PORT2", "USART1TX", "USART1RX", "PORT1", "TIMERA1", "TIMERA0", "ADC12",
+      "USART0TX", "USART0RX", "WDT", "COMPARATORA", "TIMERB1", "TIMERB0", "NMI", "RESET"
+   };
+   int i;
+
+   fprintf(f, "time        : %.6f s\n", Now);
+   fprintf(f, "active      : %.6f s (%.1f %%)\n", ActiveTime,
+           Now > 0.0 ? 100.0 * ActiveTime / Now : 0.0);
+   fprintf(f, "asleep      : %.6f s (%.1f %%)\n", SleepTime,
+           Now > 0.0 ? 100.0 * SleepTime / Now : 0.0);
+   fprintf(f, "cycles      : %llu\n", Cycles);
+   fprintf(f, "energy      : %.1f uJ (%.2f uA average at %.1f V)\n", Charge * VCC * 1e6,
+           Now > 0.0 ? Charge / Now * 1e6 : 0.0, VCC);
+   fprintf(f, "lcd bytes   : %lu\n", LcdBytes);
+   fprintf(f, "uart1 bytes : %lu\n", UartBytes);
+   if(FlashWrites || FlashErrors)
+   {
+      unsigned long erases = 0;
+      for(i = 0; i < (int)(sizeof(FlashErases) / sizeof(FlashErases[0])); i++)
+         erases += FlashErases[i];
+      fprintf(f, "flash       : %lu bytes, %lu erases, %lu errors\n",
+              FlashWrites, erases, FlashErrors);
+   }
+   for(i = 0; i < SIM_NUM_VECTORS; i++)
+      if(IsrCount[i])
+         fprintf(f, "isr %-8s: %lu\n", name[i], IsrCount[i]);
+}
@@ -0,0 +1,67 @@
+/**
+ *  @file sim.h
+ *  @author TheFwGuy
+ *  @version 1.0
+ *  @date October 2026
+ *  @brief Control interface of the MSP430F169 host simulator
+ *
+ *  The simulator models the digital ports, Timer_A, Timer_B, the USART0
+ *  in SPI mode (with the PCD8544 LCD attached), the USART1 UART transmitter,
+ *  the flash controller and the interrupt vectors, and estimates the energy
+ *  from the datasheet supply current of every power mode.
+ *  Time only moves when the firmware touches a register, sleeps in a low
+ *  power mode, or when a host tool calls sim_run_until().
+ */
+#ifndef __SIM_H
+#define __SIM_H
+
+#include <stdio.h>
+
+#define SIM_NUM_VECTORS     16     /* 0xFFE0 - 0xFFFE, 2 bytes each */
+
+/* Source of the Hall signal: returns the time of the next transition and the new level */
+typedef double (*sim_wave_fn)(void *ctx, int *level);
+typedef void   (*sim_hook_fn)(int vector);
+typedef void   (*sim_end_fn)(void);
+typedef void   (*sim_byte_fn)(void *ctx, unsigned char b);
+
+void   sim_reset(void);
+double sim_time(void);
+void   sim_run_until(double t);
+void   sim_set_end(double t, sim_end_fn fn);
+
+void   sim_set_hall(sim_wave_fn fn, void *ctx);
+void   sim_pin(int port, int bit, int level);
+void   sim_schedule_pin(double t, int port, int bit, int level);
+void   sim_set_isr_hook(sim_hook_fn fn);
+
+unsigned long sim_isr_count(int vector);
+unsigned long long sim_cycles(void);
+double sim_active_time(void);
+double sim_sleep_time(void);
+double sim_energy(void);              /* joule, from the datasheet supply currents */
+double sim_mclk_hz(void);
+double sim_smclk_hz(void);
+double sim_aclk_hz(void);
+
+/* LCD (PCD8544) model */
+unsigned long sim_lcd_bytes(void);
+double sim_lcd_last_byte(void);
+unsigned char sim_lcd_ram(int bank, int x);
+void   sim_lcd_dump(FILE *f);
+
+/* USART1 UART: every byte is handed over at the end of its stop bit */
+void   sim_set_uart1(sim_byte_fn fn, void *ctx);
+unsigned long sim_uart1_bytes(void);
+
+/* Flash memory image (0x1000 - 0xFFFF), erased at reset */
+void   sim_flash_read(unsigned int addr, unsigned char *buf, unsigned int len);
+int    sim_flash_load(const char *path);
+int    sim_flash_save(const char *path);
+unsigned long sim_flash_writes(void);
+unsigned long sim_flash_errors(void);
+unsigned long sim_flash_erases(unsigned int addr);
+
+void   sim_report(FILE *f);
+
+#endif
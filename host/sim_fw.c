@@ -0,0 +1,159 @@
+/**
+ *  @file sim_fw.c
+ *  @author TheFwGuy
+ *  @version 1.0
+ *  @date October 2026
+ *  @brief Scenario setup for running the whole firmware on the host
+ *
+ *  The scenario is taken from the environment before main() runs:
+ *    SIM_TIME     simulated seconds before the report (default 10)
+ *    SIM_RPM      rotor speed (default 600)
+ *    SIM_MAGNETS  magnets on the rotor (default 2)
+ *    SIM_KEYS     joystick script, "time:key[:hold],..." with key one of
+ *                 up, down, left, right, push (held for 100 ms by default)
+ *    SIM_UART     file, fifo or pty getting the USART1 (telemetry) bytes
+ *    SIM_FLASH    flash image, loaded at start if it exists and saved at the
+ *                 end, so the flash content survives from run to run
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+#include "boot.h"
+
+#define KEY_HOLD   0.1
+
+/* Boot stage names for the report, in BOOT_xxx order */
+static const char *BootName[BOOT_STAGES] =
+{
+   "boot param ", "boot lcd   ", "boot periph", "boot xtal  ", "boot timer ", "first read "
+};
+
+static double Rpm;
+static int    Magnets;
+static double NextEdge;
+static int    Level;
+static FILE  *Uart;
+
+/* Square wave, one pulse per magnet, 50% duty cycle */
+static double HallWave(void *ctx, int *level)
+{
+   double half = 60.0 / (Rpm * Magnets) / 2.0;
+
+   (void)ctx;
+   NextEdge += half;
+   Level = !Level;
+   *level = Level;
+   return NextEdge;
+}
+
+static void Keys(const char *script)
+{
+   char  buf[256];
+   char *tok, *sep, *hold;
+   double t, held;
+   int   port, bit;
+
+   strncpy(buf, script, sizeof(buf) - 1);
+   buf[sizeof(buf) - 1] = 0;
+
+   for(tok = strtok(buf, ","); tok; tok = strtok(NULL, ","))
+   {
+      sep = strchr(tok, ':');
+      if(!sep)
+         continue;
+      *sep++ = 0;
+      t = atof(tok);
+
+      held = KEY_HOLD;
+      hold = strchr(sep, ':');
+      if(hold)
+      {
+         *hold++ = 0;
+         held = atof(hold);
+      }
+
+      port = 1;
+      if(!strcmp(sep, "up"))          bit = 6;
+      else if(!strcmp(sep, "down"))   bit = 5;
+      else if(!strcmp(sep, "left"))   bit = 7;
+      else if(!strcmp(sep, "right"))  bit = 4;
+      else if(!strcmp(sep, "push"))   { port = 2; bit = 0; }
+      else
+      {
+         fprintf(stderr, "sim: unknown key '%s'\n", sep);
+         continue;
+      }
+
+      /* Joystick contacts are active low */
+      sim_schedule_pin(t, port, bit, 0);
+      sim_schedule_pin(t + held, port, bit, 1);
+   }
+}
+
+/* USART1 byte out of the shift register */
+static void UartByte(void *ctx, unsigned char b)
+{
+   (void)ctx;
+   fputc(b, Uart);
+}
+
+/* Boot stages as timed by the firmware, from BootStart */
+static void BootReport(void)
+{
+   int i;
+
+   for(i = 0; i < BOOT_STAGES; i++)
+   {
+      if(Boot_us[i])
+         printf("%s : %.3f ms%s\n", BootName[i], Boot_us[i] / 1000.0,
+                i == BOOT_XTAL && !Boot_xtalOk ? " (no crystal)" : "");
+      else
+         printf("%s : -\n", BootName[i]);
+   }
+}
+
+static void End(void)
+{
+   if(Uart)
+      fflush(Uart);
+   if(getenv("SIM_FLASH") && sim_flash_save(getenv("SIM_FLASH")))
+      perror("sim: SIM_FLASH");
+   sim_lcd_dump(stdout);
+   sim_report(stdout);
+   BootReport();
+}
+
+static const char *Env(const char *name, const char *def)
+{
+   const char *v = getenv(name);
+
+   return v ? v : def;
+}
+
+__attribute__((constructor))
+static void SimFirmwareSetup(void)
+{
+   setvbuf(stdout, NULL, _IOLBF, 0);
+   sim_reset();
+
+   Rpm     = atof(Env("SIM_RPM", "600"));
+   Magnets = atoi(Env("SIM_MAGNETS", "2"));
+   if(Rpm > 0.0 && Magnets > 0)
+      sim_set_hall(HallWave, NULL);
+
+   Keys(Env("SIM_KEYS", ""));
+
+   if(getenv("SIM_FLASH"))
+      sim_flash_load(getenv("SIM_FLASH"));
+
+   if(getenv("SIM_UART"))
+   {
+      Uart = fopen(getenv("SIM_UART"), "wb");
+      if(Uart)
+         sim_set_uart1(UartByte, NULL);
+      else
+         perror("sim: SIM_UART");
+   }
+   sim_set_end(atof(Env("SIM_TIME", "10")), End);
+}
@@ -0,0 +1,150 @@
+/**
+ *  @file telemdec.c
+ *  @author TheFwGuy
+ *  @version 1.0
+ *  @date October 2026
+ *  @brief Decoder of the telemetry stream (telem.c) to CSV
+ *
+ *  Usage: telemdec [file | serial port]   (stdin when omitted)
+ *
+ *  A serial port (or pty) is set raw at 9600 8N1. The decoder looks for the
+ *  sync bytes, checks the checksum of every frame and resynchronises on the
+ *  next sync pair inside a bad one. The bytes read are never dropped.
+ *  One CSV line is printed for every good frame, the frames lost on the
+ *  target (ring full) or on the line show up as sequence gaps and are added
+ *  up on stderr at the end.
+ *
+ *  Test against the host simulator:
+ *    SIM_UART=/tmp/t.bin SIM_KEYS=0.5:down,0.7:push ./hostbuild/rpm_host
+ *    ./hostbuild/telemdec /tmp/t.bin
+ *  or live, through a fifo (mkfifo /tmp/t.fifo) or a pty pair
+ *  (socat pty,link=/tmp/ttyA,raw pty,link=/tmp/ttyB,raw).
+ */
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include "rpm.h"
+#include "telem.h"
+
+static const char *ModeName[MEAS_NUM] = { "gate", "period", "hwcount", "auto" };
+
+static unsigned long Get32(const unsigned char *p)
+{
+   return (unsigned long)p[0] | ((unsigned long)p[1] << 8) |
+          ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+/* Raw 9600 8N1 when the input is a serial port or a pty */
+static void SerialSetup(int fd)
+{
+   struct termios tio;
+
+   if(!isatty(fd) || tcgetattr(fd, &tio) < 0)
+      return;
+   cfmakeraw(&tio);
+   cfsetispeed(&tio, B9600);
+   cfsetospeed(&tio, B9600);
+   tio.c_cflag |= CLOCAL | CREAD;
+   tio.c_cflag &= ~(CSTOPB | PARENB);
+   tio.c_cc[VMIN]  = 1;
+   tio.c_cc[VTIME] = 0;
+   tcsetattr(fd, TCSANOW, &tio);
+}
+
+/*
+ *  Drop the bytes before the next sync pair after f[0] (or before a sync
+ *  byte at the end, its pair not read yet), gives what is left
+ */
+static int Resync(unsigned char *f, int len)
+{
+   int k;
+
+   for(k = 1; k < len; k++)
+   {
+      if(f[k] == TELEM_SYNC0 && (k + 1 == len || f[k + 1] == TELEM_SYNC1))
+      {
+         memmove(f, &f[k], len - k);
+         return len - k;
+      }
+   }
+   return 0;
+}
+
+static void Frame(const unsigned char *f)
+{
+   unsigned char flags = f[3];
+   unsigned char mode  = TELEM_MODE(flags);
+   unsigned long rpm10 = Get32(&f[16]);
+
+   printf("%u,%.6f,%s,%lu,%lu,%lu.%lu,%d,%d\n", f[2],
+          Get32(&f[4]) / 32768.0,
+          mode < MEAS_NUM ? ModeName[mode] : "?",
+          Get32(&f[8]), Get32(&f[12]), rpm10 / 10, rpm10 % 10,
+          (flags & TELEM_STALL) != 0, (flags & TELEM_TRIP) != 0);
+}
+
+int main(int argc, char **argv)
+{
+   unsigned char buf[256];
+   unsigned char f[TELEM_LEN];
+   unsigned long good = 0, bad = 0, lost = 0;
+   unsigned char sum;
+   int   fd = 0, n, i, k, len = 0, seq = -1;
+
+   if(argc > 1)
+   {
+      fd = open(argv[1], O_RDONLY | O_NOCTTY);
+      if(fd < 0)
+      {
+         perror(argv[1]);
+         return 1;
+      }
+   }
+   SerialSetup(fd);
+   setvbuf(stdout, NULL, _IOLBF, 0);
+
+   printf("seq,time_s,mode,count,gate,rpm,stall,trip\n");
+
+   while((n = read(fd, buf, sizeof(buf))) > 0)
+   {
+      for(i = 0; i < n; i++)
+      {
+         f[len++] = buf[i];
+
+         // Sync bytes
+         if(len == 1 && f[0] != TELEM_SYNC0)
+            len = 0;
+         else if(len == 2 && f[1] != TELEM_SYNC1)
+            len = Resync(f, len);
+         if(len < TELEM_LEN)
+            continue;
+
+         for(sum = 0, k = 2; k < TELEM_LEN - 1; k++)
+            sum += f[k];
+         if(sum != f[TELEM_LEN - 1])
+         {
+            // Bad frame : the next frame may start inside it
+            bad++;
+            len = Resync(f, len);
+            continue;
+         }
+
+         if(seq >= 0)
+            lost += (unsigned char)(f[2] - seq - 1);
+         seq = f[2];
+         good++;
+         Frame(f);
+         len = 0;
+      }
+   }
+
+   fprintf(stderr, "telemdec: %lu frames, %lu bad, %lu lost\n", good, bad, lost);
+   return 0;
+}
+
+/*
+ *  This code is documented using DoxyGen
+ *  (http://www.stack.nl/~dimitri/doxygen/index.html)
+ */
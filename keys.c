@@ -0,0 +1,247 @@
+/**
+ *  @file keys.c
+ *  @author TheFwGuy
+ *  @version 1.0
+ *  @date October 2026
+ *  @brief Joystick input
+ *
+ *  While all the keys are released the joystick contacts only generate a
+ *  port interrupt on the falling (press) edge and no timer runs. The first
+ *  edge disables the key interrupts and starts the watchdog as a 15.6 ms
+ *  interval timer: a change of the contacts is accepted once KEY_STABLE
+ *  samples agree, which filters the bounces. Press, release and
+ *  auto-repeat events go in a small queue for the main loop, written only
+ *  by the interrupt routine (KeyHead) and read only by the main loop
+ *  (KeyTail), so no lock is needed. When all the keys are released the
+ *  timer is stopped and the port interrupts are enabled again.
+ */
+
+#include "system.h"
+#include "keys.h"
+#include "hal.h"
+
+unsigned char KeyState;          /* Debounced keys, 1 = pressed */
+unsigned char KeyRaw;            /* Last sample */
+unsigned char KeyStable;         /* Equal samples in a row */
+unsigned char KeyHeld;           /* Samples since the last press or repeat */
+
+volatile unsigned char KeyQueue[KEY_QUEUE_SIZE];
+volatile unsigned char KeyHead;  /* Next event to write (interrupt) */
+volatile unsigned char KeyTail;  /* Next event to read (main loop) */
+
+/* Key identifier of every bit of the key mask */
+static const unsigned char KeyIdTab[8] =
+{
+   KEY_ID_PUSH, KEY_NONE, KEY_NONE, KEY_NONE,
+   KEY_ID_RIGHT, KEY_ID_DOWN, KEY_ID_UP, KEY_ID_LEFT
+};
+
+/**
+ *  @fn KeyRead
+ *  @brief The function reads the joystick contacts
+ *
+ *  @param none
+ *  @return key mask, 1 = pressed
+ */
+static unsigned char KeyRead(void)
+{
+   return (~P1IN & KEY_P1_MASK) | (~P2IN & KEY_PUSH);
+}
+
+/**
+ *  @fn KeyPut
+ *  @brief The function queues an event for every key of the mask
+ *
+ *  If the queue is full the event is lost.
+ *
+ *  @param keys   key mask
+ *  @param event  KEY_EV_PRESS, KEY_EV_RELEASE or KEY_EV_REPEAT
+ *  @return none
+ */
+static void KeyPut(unsigned char keys, unsigned char event)
+{
+   unsigned char i;
+   unsigned char next;
+
+   for(i = 0; i < 8; i++)
+   {
+      if(!(keys & (1 << i)))
+         continue;
+
+      next = (KeyHead + 1) & (KEY_QUEUE_SIZE - 1);
+      if(next == KeyTail)
+         return;
+
+      KeyQueue[KeyHead] = KeyIdTab[i] | event;
+      KeyHead = next;
+   }
+}
+
+/**
+ *  @fn KeyArm
+ *  @brief The function waits for a press on the port interrupts
+ *
+ *  @param none
+ *  @return none
+ */
+static void KeyArm(void)
+{
+   P1IES |= KEY_P1_MASK;      /* Falling edge : key pressed */
+   P1IFG &= ~KEY_P1_MASK;
+   P1IE  |= KEY_P1_MASK;
+
+   P2IES |= KEY_PUSH;
+   P2IFG &= ~KEY_PUSH;
+   P2IE  |= KEY_PUSH;
+}
+
+/**
+ *  @fn KeyScan
+ *  @brief The function starts the debounce timer
+ *
+ *  Called on the first edge : the port interrupts are not needed anymore
+ *  until all the keys are released.
+ *
+ *  @param none
+ *  @return none
+ */
+static void KeyScan(void)
+{
+   P1IE  &= ~KEY_P1_MASK;
+   P1IFG &= ~KEY_P1_MASK;
+   P2IE  &= ~KEY_PUSH;
+   P2IFG &= ~KEY_PUSH;
+
+   KeyStable = 0;
+   WDTCTL = WDT_ADLY_16;      /* Interval timer on ACLK */
+   IFG1  &= ~WDTIFG;
+   IE1   |= WDTIE;
+}
+
+/**
+ *  @fn KeyInit
+ *  @brief The function initializes the joystick input
+ *
+ *  @param none
+ *  @return none
+ */
+void KeyInit(void)
+{
+   KeyState = 0;
+   KeyHead  = 0;
+   KeyTail  = 0;
+
+   KeyArm();
+   if(KeyRead())
+      KeyScan();
+}
+
+/**
+ *  @fn KeyGet
+ *  @brief The function returns the next joystick event
+ *
+ *  @param none
+ *  @return event (key identifier | event type), KEY_NONE if none
+ */
+unsigned char KeyGet(void)
+{
+   unsigned char event;
+
+   if(KeyTail == KeyHead)
+      return KEY_NONE;
+
+   event   = KeyQueue[KeyTail];
+   KeyTail = (KeyTail + 1) & (KEY_QUEUE_SIZE - 1);
+   return event;
+}
+
+/**
+ *  @fn KeyPort1
+ *  @brief The function handles the joystick edges on port 1
+ *
+ *  Called by PORT1_ISR, which is shared with the Hall sensor.
+ *
+ *  @param none
+ *  @return none
+ */
+void KeyPort1(void)
+{
+   KeyScan();
+}
+
+/**
+ * I/O Port 2
+ * @brief I/O port 2 interrupt service routine
+ *
+ * This function handle the joystick pushbutton edge.
+ *
+ * @param none
+ * @return None
+ */
+interrupt(PORT2_VECTOR) PORT2_ISR(void)
+{
+   if(P2IFG & P2IE & KEY_PUSH)
+      KeyScan();
+}
+
+/**
+ * Watchdog
+ * @brief Watchdog interval timer interrupt service routine
+ *
+ * This function samples the joystick every 15.6 ms while a key is pressed
+ * or bouncing, and generates the events.
+ *
+ * @param none
+ * @return None
+ */
+interrupt(WDT_VECTOR) WDT_ISR(void)
+{
+   unsigned char raw = KeyRead();
+   unsigned char changed;
+
+   if(raw != KeyRaw)
+   {
+      KeyRaw    = raw;
+      KeyStable = 1;
+      return;
+   }
+
+   if(KeyStable < KEY_STABLE)
+   {
+      if(++KeyStable < KEY_STABLE)
+         return;
+
+      changed = raw ^ KeyState;
+      if(changed)
+      {
+         KeyState = raw;
+         KeyHeld  = 0;
+         KeyPut(changed & raw, KEY_EV_PRESS);
+         KeyPut(changed & ~raw, KEY_EV_RELEASE);
+         SYS_WAKE();
+      }
+   }
+
+   if(KeyState == 0)
+   {
+      /* All released : stop the timer until the next press */
+      WDTCTL = WDTPW + WDTHOLD;
+      IE1   &= ~WDTIE;
+      KeyArm();
+      if(KeyRead())
+         KeyScan();      /* Pressed again before the interrupt was armed */
+      return;
+   }
+
+   if((KeyState & KEY_REPEAT_MASK) && ++KeyHeld >= KEY_DELAY)
+   {
+      KeyHeld = KEY_DELAY - KEY_RATE;
+      KeyPut(KeyState & KEY_REPEAT_MASK, KEY_EV_REPEAT);
+      SYS_WAKE();
+   }
+}
+
+/*
+ *  This code is documented using DoxyGen
+ *  (http://www.stack.nl/~dimitri/doxygen/index.html)
+ */
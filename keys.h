@@ -0,0 +1,51 @@
+/**
+ *  @file keys.h
+ *  @author TheFwGuy
+ *  @version 1.0
+ *  @date October 2026
+ *  @brief Header file for the keys.c
+ */
+#ifndef __KEYS_H
+#define __KEYS_H
+
+/* definitions */
+
+// JOYSTICK (active low)
+#define KEY_RIGHT       BIT_4    /* P1.4 - decrement value */
+#define KEY_DOWN        BIT_5    /* P1.5 */
+#define KEY_UP          BIT_6    /* P1.6 */
+#define KEY_LEFT        BIT_7    /* P1.7 - increment value */
+#define KEY_P1_MASK     (KEY_RIGHT | KEY_DOWN | KEY_UP | KEY_LEFT)
+#define KEY_PUSH        BIT_0    /* P2.0 */
+#define KEY_REPEAT_MASK KEY_P1_MASK   /* Keys with auto-repeat */
+
+// DEBOUNCE (WDT interval timer, 512 ACLK ticks = 15.6 ms)
+#define KEY_STABLE      2        /* Equal samples before a change is accepted */
+#define KEY_DELAY       32       /* Samples before the first repeat (500 ms) */
+#define KEY_RATE        10       /* Samples between repeats (156 ms) */
+
+#define KEY_QUEUE_SIZE  8        /* Events in the queue, power of two */
+
+// EVENTS : key identifier | event type
+#define KEY_NONE        0
+#define KEY_ID_UP       1
+#define KEY_ID_DOWN     2
+#define KEY_ID_LEFT     3
+#define KEY_ID_RIGHT    4
+#define KEY_ID_PUSH     5
+
+#define KEY_EV_PRESS    0x10
+#define KEY_EV_RELEASE  0x20
+#define KEY_EV_REPEAT   0x40
+
+#define KEY_ID(e)       ((e) & 0x0F)
+#define KEY_EV(e)       ((e) & 0xF0)
+
+/*
+ *  Function prototypes
+ */
+void KeyInit(void);
+void KeyPort1(void);
+unsigned char KeyGet(void);
+
+#endif
@@ -1,6 +1,6 @@
 #include "lcd_new.h"
 #include "system.h"
-#include <io.h>
+#include "hal.h"
 
 // LCD memory index
 unsigned int  LcdMemIdx;
@@ -8,19 +8,74 @@ unsigned int  LcdMemIdx;
 // represent LCD matrix
 unsigned char  LcdMemory[LCD_CACHE_SIZE];
 
-// simple delay
-void Delay(unsigned long a) { while (--a!=0); }
+// changed columns of every bank since the last update (clean if Lo > Hi)
+unsigned char  LcdDirtyLo[LCD_BANKS];
+unsigned char  LcdDirtyHi[LCD_BANKS];
+
+// asynchronous flush state, used by the USART0 TX interrupt
+unsigned char  LcdTxBank;               // bank being sent
+unsigned char  LcdTxStep;               // position in the bank sequence
+unsigned char  LcdTxLeft;               // data bytes left in the span
+const unsigned char *LcdTxPtr;          // next data byte
+
+#define TX_ADDR_X       0
+#define TX_ADDR_Y       1
+#define TX_DATA_START   2
+#define TX_DATA         3
+
+// PCD8544 setup sequence
+static const unsigned char LcdInitCmd[] =
+{
+   0x21,    // LCD Extended Commands.
+   0xC8,    // Set LCD Vop (Contrast).
+   0x06,    // Set Temp coefficent.
+   0x13,    // LCD bias mode 1:48.
+   0x20,    // LCD Standard Commands, Horizontal addressing mode.
+   0x08,    // LCD blank
+   0x0C     // LCD in normal mode.
+};
+
+// Address X=0 Y=0
+static const unsigned char LcdHome[] = { 0x80, 0x40 };
+
+// powers of ten for the number formatter
+static const unsigned long LcdPow10[10] =
+{
+   1UL, 10UL, 100UL, 1000UL, 10000UL, 100000UL,
+   1000000UL, 10000000UL, 100000000UL, 1000000000UL
+};
+
+/****************************************************************************/
+/*  Mark a column range of a bank as changed                                */
+/*  Function : LCDDirty                                                     */
+/*      Parameters                                                          */
+/*          Input   :  bank, first and last column                          */
+/*          Output  :  Nothing                                              */
+/****************************************************************************/
+static void LCDDirty(unsigned char bank, unsigned char x0, unsigned char x1)
+{
+   if(x0 < LcdDirtyLo[bank])
+      LcdDirtyLo[bank] = x0;
+   if(x1 > LcdDirtyHi[bank] || LcdDirtyLo[bank] > LcdDirtyHi[bank])
+      LcdDirtyHi[bank] = x1;
+}
 
 
 /****************************************************************************/
 /*  Init LCD Controler                                                      */
 /*  Function : LCDInit                                                      */
+/*      The reset pulse (100 ns at least) lasts while the USART0 is set up  */
+/*      and the controller takes commands right after it, so no software    */
+/*      delay is needed. Only SMCLK is used : the 32kHz crystal may still   */
+/*      be starting.                                                        */
 /*      Parameters                                                          */
 /*          Input   :  Nothing                                              */
 /*          Output  :  Nothing                                              */
 /****************************************************************************/
 void LCDInit(void)
 {
+   unsigned char i;
+
    //  Pull-up on reset pin.
    P5OUT |= BIT_4;
 
@@ -38,13 +93,11 @@ void LCDInit(void)
    P3SEL &= ~SOMI0;          /* SOMI0 D/S */
    P3SEL |= ULCK0;           /* ULCK0 */
 
-   //  Toggle display reset pin.
+   //  Display reset pin low, for the USART0 setup.
    P5OUT &= ~BIT_4;
-   Delay(10000);
-   P5OUT |= BIT_4;
 
-   // Init SPI
-   U0CTL   = 0x16;   // SPI Mode, 8bit, Master mode
+   // Init SPI (keep the USART in reset while configuring it)
+   U0CTL   = 0x17;   // SPI Mode, 8bit, Master mode, SWRST
    U0TCTL  = 0xB2;   // 3pin Mode, clock->SMCLK, no CKPL (poliarity), no CKPH (phase)
    //U0TCTL  = 0x30;   // 4pin Mode, clock->SMCLK, no CKPL (poliarity), no CKPH (phase)
 
@@ -57,23 +110,27 @@ void LCDInit(void)
    ME1     = 0x40;   // Enable SPI0
    ME2     = 0x01;   // Enable SPI0
 
+   U0CTL  &= ~SWRST; // Release the USART, UTXIFG0 is set
+
    // Disable display controller.
    P3OUT |= STE0;
 
-   Delay(100);
+   //  End of the display reset pulse.
+   P5OUT |= BIT_4;
 
    // Send sequence of command
-   LCDSend( 0x21, SEND_CMD );  // LCD Extended Commands.
-   LCDSend( 0xC8, SEND_CMD );  // Set LCD Vop (Contrast).
-   LCDSend( 0x06, SEND_CMD );  // Set Temp coefficent.
-   LCDSend( 0x13, SEND_CMD );  // LCD bias mode 1:48.
-   LCDSend( 0x20, SEND_CMD );  // LCD Standard Commands, Horizontal addressing mode.
-   LCDSend( 0x08, SEND_CMD );  // LCD blank
-   LCDSend( 0x0C, SEND_CMD );  // LCD in normal mode.
-
-   // Clear and Update
+   LCDSendBuf( LcdInitCmd, sizeof(LcdInitCmd), SEND_CMD );
+
+   // Clear and Update, the controller RAM content is unknown after reset.
+   // Interrupts are still disabled here, so the whole frame is sent directly.
    LCDClear();
-   LCDUpdate();
+   for (i=0; i<LCD_BANKS; i++)
+   {
+      LcdDirtyLo[i] = LCD_X_RES;
+      LcdDirtyHi[i] = 0;
+   }
+   LCDSendBuf( LcdHome, sizeof(LcdHome), SEND_CMD );
+   LCDSendBuf( LcdMemory, LCD_CACHE_SIZE, SEND_CHR );
 }
 
 /****************************************************************************/
@@ -86,6 +143,25 @@ void LCDInit(void)
 void
 LCDSend(unsigned char data, unsigned char cd)
 {
+   LCDSendBuf(&data, 1, cd);
+}
+
+/****************************************************************************/
+/*  Send a buffer to LCD                                                    */
+/*  Function : LCDSendBuf                                                   */
+/*      The controller stays enabled for the whole buffer and the next      */
+/*      byte is written as soon as U0TXBUF is free, so the SPI clock runs   */
+/*      without gaps. D/C can only change once the shift register is empty. */
+/*      A running asynchronous update is completed first.                   */
+/*      Parameters                                                          */
+/*          Input   :  data, length and  SEND_CHR or SEND_CMD               */
+/*          Output  :  Nothing                                              */
+/****************************************************************************/
+void
+LCDSendBuf(const unsigned char *dataPtr, unsigned int len, unsigned char cd)
+{
+   LCDWait();
+
    // Enable display controller (active low).
    P3OUT &= ~STE0;  /* reset STE0 (CE) */
 
@@ -101,10 +177,17 @@ LCDSend(unsigned char data, unsigned char cd)
 
    ///// SEND SPI /////
 
-   //send data
-   U0TXBUF = data;
+   // The bus is idle here, the first byte goes directly to the shift register
+   while(len--)
+   {
+      //send data
+      U0TXBUF = *dataPtr++;
+
+      //Wait for free U0TXBUF
+      while((IFG1 & UTXIFG0) == 0);
+   }
 
-   //Wait for ready U0TXBUF
+   //Wait for the last byte to leave the shift register
    while((U0TCTL & TXEPT) == 0);
 
    // Disable display controller.
@@ -114,21 +197,136 @@ LCDSend(unsigned char data, unsigned char cd)
 /****************************************************************************/
 /*  Update LCD memory                                                       */
 /*  Function : LCDUpdate                                                    */
+/*      Only the columns changed since the last update are sent. The        */
+/*      transfer is done by the USART0 TX interrupt, the function returns   */
+/*      immediately. Drawing functions wait for the end of the transfer.    */
 /*      Parameters                                                          */
 /*          Input   :  Nothing                                              */
 /*          Output  :  Nothing                                              */
 /****************************************************************************/
 void LCDUpdate ( void )
 {
-  int i;
+  unsigned char bank;
+
+  LCDWait();
+
+  for (bank=0; bank<LCD_BANKS; bank++)
+  {
+    if (LcdDirtyLo[bank] <= LcdDirtyHi[bank])
+      break;
+  }
+  if (bank == LCD_BANKS)
+    return;
+
+  LcdTxBank = bank;
+  LcdTxStep = TX_ADDR_X;
+
+  // Enable display controller (active low), commands first.
+  P3OUT &= ~STE0;
+  P3OUT &= ~SOMI0;
+
+  // U0TXBUF is free: raise the flag to start the interrupt chain
+  SYS_BARRIER();
+  IFG1 |= UTXIFG0;
+  IE1  |= UTXIE0;
+}
+
+/****************************************************************************/
+/*  Check LCD update                                                        */
+/*  Function : LCDBusy                                                      */
+/*      Parameters                                                          */
+/*          Input   :  Nothing                                              */
+/*          Output  :  TRUE while an update is being transmitted            */
+/****************************************************************************/
+unsigned char LCDBusy ( void )
+{
+  return (IE1 & UTXIE0) ? TRUE : FALSE;
+}
 
-  //  Set base address X=0 Y=0
-  LCDSend(0x80, SEND_CMD );
-  LCDSend(0x40, SEND_CMD );
+/****************************************************************************/
+/*  Wait LCD update                                                         */
+/*  Function : LCDWait                                                      */
+/*      Sleeps in LPM0 (the SPI needs SMCLK) until the transfer is done     */
+/*      SysEvent is left alone : a key or a reading arrived meanwhile is    */
+/*      still pending for the next SysSleep of the caller                   */
+/*      Must be called with the interrupts enabled if a transfer is running */
+/*      Parameters                                                          */
+/*          Input   :  Nothing                                              */
+/*          Output  :  Nothing                                              */
+/****************************************************************************/
+void LCDWait ( void )
+{
+  while (IE1 & UTXIE0)
+  {
+    // Check and sleep with the interrupts disabled in between
+    dint();
+    if (IE1 & UTXIE0)
+      _BIS_SR(LPM0_bits + GIE);
+    else
+      eint();
+  }
+  SYS_BARRIER();
+}
 
-  //  Serialize the video buffer.
-  for (i=0; i<LCD_CACHE_SIZE; i++) {
-    LCDSend( LcdMemory[i], SEND_CHR );
+/****************************************************************************/
+/*  USART0 TX interrupt                                                     */
+/*  Function : USART0TX_ISR                                                 */
+/*      Sends one byte of the update at every call : for every dirty bank   */
+/*      the X and Y address commands, then the changed columns.             */
+/*      Parameters                                                          */
+/*          Input   :  Nothing                                              */
+/*          Output  :  Nothing                                              */
+/****************************************************************************/
+interrupt(USART0TX_VECTOR) USART0TX_ISR(void)
+{
+  switch (LcdTxStep)
+  {
+    case TX_ADDR_X:
+      // Look for the next dirty bank
+      while (LcdTxBank < LCD_BANKS && LcdDirtyLo[LcdTxBank] > LcdDirtyHi[LcdTxBank])
+        LcdTxBank++;
+
+      // D/C must not change while the last data byte is shifted out
+      while ((U0TCTL & TXEPT) == 0);
+
+      if (LcdTxBank >= LCD_BANKS)
+      {
+        // Done: disable display controller and the interrupt
+        P3OUT |= STE0;
+        IE1   &= ~UTXIE0;
+        SYS_WAKE();
+        return;
+      }
+
+      P3OUT &= ~SOMI0;
+      U0TXBUF = 0x80 | LcdDirtyLo[LcdTxBank];
+      LcdTxStep = TX_ADDR_Y;
+      break;
+
+    case TX_ADDR_Y:
+      U0TXBUF = 0x40 | LcdTxBank;
+      LcdTxStep = TX_DATA_START;
+      break;
+
+    case TX_DATA_START:
+      LcdTxPtr  = &LcdMemory[LcdTxBank * LCD_X_RES + LcdDirtyLo[LcdTxBank]];
+      LcdTxLeft = LcdDirtyHi[LcdTxBank] - LcdDirtyLo[LcdTxBank] + 1;
+      LcdDirtyLo[LcdTxBank] = LCD_X_RES;
+      LcdDirtyHi[LcdTxBank] = 0;
+
+      while ((U0TCTL & TXEPT) == 0);
+      P3OUT |= SOMI0;
+      LcdTxStep = TX_DATA;
+      // fall through
+
+    case TX_DATA:
+      U0TXBUF = *LcdTxPtr++;
+      if (--LcdTxLeft == 0)
+      {
+        LcdTxBank++;
+        LcdTxStep = TX_ADDR_X;
+      }
+      break;
   }
 }
 
@@ -141,12 +339,22 @@ void LCDUpdate ( void )
 /****************************************************************************/
 void LCDClear(void) {
 
-  int i;
+  unsigned char bank, x;
+  unsigned int  i = 0;
+
+  LCDWait();
 
   // loop all cashe array
-  for (i=0; i<LCD_CACHE_SIZE; i++)
+  for (bank=0; bank<LCD_BANKS; bank++)
   {
-     LcdMemory[i] = 0;
+     for (x=0; x<LCD_X_RES; x++, i++)
+     {
+        if (LcdMemory[i])
+        {
+           LcdMemory[i] = 0;
+           LCDDirty(bank, x, x);
+        }
+     }
   }
 
 }
@@ -163,17 +371,21 @@ void LCDPixel (unsigned char x, unsigned char y, unsigned char mode )
     unsigned int    index   = 0;
     unsigned char   offset  = 0;
     unsigned char   data    = 0;
+    unsigned char   bank;
 
     // check for out off range
-    if ( x > LCD_X_RES )
+    if ( x >= LCD_X_RES )
        return;
-    if ( y > LCD_Y_RES )
+    if ( y >= LCD_Y_RES )
        return;
 
+    LCDWait();
+
     index = ((y / 8) * 84) + x;
     offset  = y - ((y / 8) * 8);
 
     data = LcdMemory[index];
+    bank = y / 8;
 
     if ( mode == PIXEL_OFF )
     {
@@ -188,7 +400,11 @@ void LCDPixel (unsigned char x, unsigned char y, unsigned char mode )
         data ^= (0x01 << offset);
     }
 
-    LcdMemory[index] = data;
+    if ( data != LcdMemory[index] )
+    {
+        LcdMemory[index] = data;
+        LCDDirty(bank, x, x);
+    }
 
 }
 
@@ -203,6 +419,9 @@ void LCDChrXY (unsigned char x, unsigned char y, unsigned char ch )
 {
     unsigned int    index   = 0;
     unsigned int    i       = 0;
+    unsigned short  col;
+    unsigned char   bank;
+    unsigned char   data;
 
     // check for out off range
     if ( x > LCD_X_RES )
@@ -210,11 +429,29 @@ void LCDChrXY (unsigned char x, unsigned char y, unsigned char ch )
     if ( y > LCD_Y_RES )
        return;
 
-    index = (x*48 + y*48*14)/8 ;
+    // long strings continue on the next bank
+    col  = x * 6;
+    bank = y;
+    while ( col >= LCD_X_RES )
+    {
+       col -= LCD_X_RES;
+       bank++;
+    }
+    if ( bank >= LCD_BANKS )
+       return;
+
+    LCDWait();
+
+    index = bank * LCD_X_RES + col;
 
     for ( i = 0; i < 5; i++ )
     {
-      LcdMemory[index] = FontLookup[ch - 32][i] << 1;
+      data = FontLookup[ch - 32][i] << 1;
+      if ( LcdMemory[index] != data )
+      {
+        LcdMemory[index] = data;
+        LCDDirty(bank, col + i, col + i);
+      }
       index++;
     }
 
@@ -229,14 +466,18 @@ void LCDChrXY (unsigned char x, unsigned char y, unsigned char ch )
 /****************************************************************************/
 void LCDContrast(unsigned char contrast) {
 
+    unsigned char cmd[3];
+
     //  LCD Extended Commands.
-    LCDSend( 0x21, SEND_CMD );
+    cmd[0] = 0x21;
 
     // Set LCD Vop (Contrast).
-    LCDSend( 0x80 | contrast, SEND_CMD );
+    cmd[1] = 0x80 | contrast;
 
     //  LCD Standard Commands, horizontal addressing mode.
-    LCDSend( 0x20, SEND_CMD );
+    cmd[2] = 0x20;
+
+    LCDSendBuf( cmd, 3, SEND_CMD );
 }
 
 
@@ -262,4 +503,74 @@ void LCDStr(unsigned char row, unsigned char *dataPtr )
 }
 
 
+/****************************************************************************/
+/*  Format a number in a fixed width field                                  */
+/*  Function : LCDFmtNum                                                    */
+/*      Parameters                                                          */
+/*          Input   :  value, field width, decimal digits                   */
+/*          Output  :  buf (width characters, not terminated)               */
+/*                                                                          */
+/*  The number is right aligned and padded with spaces. With decimals > 0   */
+/*  a point is put before the last decimals digits (value 1234, 1 decimal  */
+/*  gives "123.4"). If the number does not fit the field is filled with '*'.*/
+/*  The digits are found by subtracting powers of ten, so no division or    */
+/*  printf code is needed.                                                  */
+/****************************************************************************/
+void LCDFmtNum(char *buf, unsigned long value, unsigned char width,
+               unsigned char decimals)
+{
+    unsigned char digits, len;
+    char d;
+
+    // at least one digit before the point
+    digits = decimals + 1;
+    while ( digits < 10 && value >= LcdPow10[digits] )
+       digits++;
+
+    len = digits + ( decimals ? 1 : 0 );
+    if ( len > width || digits > 10 )
+    {
+       while ( width-- )
+          *buf++ = '*';
+       return;
+    }
+
+    while ( width-- > len )
+       *buf++ = ' ';
+
+    while ( digits-- )
+    {
+       d = '0';
+       while ( value >= LcdPow10[digits] )
+       {
+          value -= LcdPow10[digits];
+          d++;
+       }
+       *buf++ = d;
+
+       if ( decimals && digits == decimals )
+          *buf++ = '.';
+    }
+}
+
+/****************************************************************************/
+/*  Send a number to LCD                                                    */
+/*  Function : LCDNum                                                       */
+/*      Parameters                                                          */
+/*          Input   :  x (character), row, value, field width, decimals     */
+/*          Output  :  Nothing                                              */
+/****************************************************************************/
+void LCDNum(unsigned char x, unsigned char row, unsigned long value,
+            unsigned char width, unsigned char decimals)
+{
+    char buf[LCD_NUM_WIDTH];
+    unsigned char i;
+
+    if ( width > LCD_NUM_WIDTH )
+       width = LCD_NUM_WIDTH;
+
+    LCDFmtNum( buf, value, width, decimals );
 
+    for ( i = 0; i < width; i++ )
+       LCDChrXY( x + i, row, buf[i] );
+}
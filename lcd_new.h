@@ -36,17 +36,27 @@
 #define SOMI0  0x04
 #define ULCK0  0x08
 
+#define LCD_NUM_WIDTH              14  /* characters in a row */
+
 #define LCD_CACHE_SIZE             ((LCD_X_RES * LCD_Y_RES) / 8)
+#define LCD_BANKS                  (LCD_Y_RES / 8)
 
 /* Function prototypes */
 void LCDInit(void);
 void LCDSend(unsigned char data, unsigned char cd);
+void LCDSendBuf(const unsigned char *dataPtr, unsigned int len, unsigned char cd);
 void LCDUpdate ( void );
+unsigned char LCDBusy ( void );
+void LCDWait ( void );
 void LCDClear(void);
 void LCDPixel (unsigned char x, unsigned char y, unsigned char mode );
 void LCDChrXY (unsigned char x, unsigned char y, unsigned char ch );
 void LCDContrast(unsigned char contrast);
 void LCDStr(unsigned char row, unsigned char *dataPtr );
+void LCDFmtNum(char *buf, unsigned long value, unsigned char width,
+               unsigned char decimals);
+void LCDNum(unsigned char x, unsigned char row, unsigned long value,
+            unsigned char width, unsigned char decimals);
 
 
 static const unsigned char FontLookup [][5] =
@@ -0,0 +1,436 @@
+/**
+ *  @file log.c
+ *  @author TheFwGuy
+ *  @version 1.0
+ *  @date October 2026
+ *  @brief RPM history logged in the main flash memory
+ *
+ *  The readings are encoded in a RAM batch and the batch is written as one
+ *  record when it is full (LOG_BATCH bytes) or when the run stops :
+ *    len  samples  flags  stamp  value  sample ...  checksum
+ *  len counts every byte of the record, stamp (u32, little endian) is the
+ *  time base of the first sample and value its RPM x 10, as a varint (7 bits
+ *  a byte, low first, bit 7 set when more bytes follow). Every following
+ *  sample is the varint of
+ *    zigzag(RPM x 10 - last RPM x 10) << 1 | interval changed
+ *  followed, when the interval changed, by the varint of
+ *    zigzag(interval - last interval)
+ *  so a reading at the usual refresh rate with a small change costs one
+ *  byte. The checksum is the low byte of the sum of the other bytes.
+ *
+ *  The records fill the LOG_SEGS segments of the log area in turn, each one
+ *  starting with a header carrying an increasing sequence number. A segment
+ *  is erased only when the log gets to it again, so every segment is erased
+ *  once per turn around the area, and at boot the writing goes on after the
+ *  newest record : the erases are spread evenly over the whole area, the
+ *  oldest records are overwritten.
+ *  A record holds the CPU for up to 11 ms and a segment erase for 12 ms
+ *  (see flash.c) : the counting modes may lose the edges arriving meanwhile
+ *  beyond the first, the capture modes keep the last one.
+ *
+ *  The dump sends every segment, oldest first, on the telemetry UART as
+ *    LOG_DUMP_SYNC0 LOG_DUMP_SEG slot  LOG_SEG bytes  checksum
+ *  and ends with LOG_DUMP_SYNC0 LOG_DUMP_END segments. The segments are
+ *  sent as they are, the decoding is left to the host (host/logdec.c).
+ */
+
+#include "system.h"
+#include "lcd_new.h"
+#include "rpm.h"
+#include "keys.h"
+#include "flash.h"
+#include "telem.h"
+#include "log.h"
+#include "hal.h"
+
+#define LOG_ADDR(seg)   (LOG_BASE + (unsigned int)(seg) * LOG_SEG)
+#define LOG_CHUNK       64       /* Bytes queued at once by the dump */
+
+unsigned char  LogBuf[LOG_BATCH];   /* Record being encoded */
+unsigned char  LogLen;              /* Bytes in LogBuf */
+unsigned char  LogFlags;            /* Flags of the next record */
+unsigned long  LogStamp;            /* Time base of the last sample */
+unsigned long  LogVal;              /* RPM x 10 of the last sample */
+unsigned long  LogDt;               /* Interval before the last sample */
+
+unsigned char  LogSeg;              /* Segment being written */
+unsigned short LogSeq;              /* Its sequence number */
+unsigned short LogPos;              /* Next free byte in it */
+
+unsigned long  Log_samples;         /* Samples of the current run */
+unsigned long  Log_bytes;           /* Flash bytes of the current run */
+
+/**
+ *  @fn LogHeader
+ *  @brief The function reads the header of a segment
+ *
+ *  @param seg    segment
+ *  @param seq    sequence number (output)
+ *  @return 1 if the header is valid
+ */
+static unsigned char LogHeader(unsigned char seg, unsigned short *seq)
+{
+   unsigned int  addr = LOG_ADDR(seg);
+   unsigned char lo = FLASH8(addr + 1);
+   unsigned char hi = FLASH8(addr + 2);
+
+   *seq = lo | ((unsigned short)hi << 8);
+   return FLASH8(addr) == LOG_MAGIC && FLASH8(addr + 3) == LOG_CHECK(lo, hi);
+}
+
+/**
+ *  @fn LogInit
+ *  @brief The function finds the end of the log at boot
+ *
+ *  @param none
+ *  @return none
+ */
+void LogInit(void)
+{
+   unsigned int  addr;
+   unsigned short seq;
+   unsigned char seg, len;
+   unsigned char found = 0;
+
+   // Empty log : the first record goes in segment 0
+   LogSeg = LOG_SEGS - 1;
+   LogSeq = 0xFFFF;
+   LogPos = LOG_SEG;
+
+   for(seg = 0; seg < LOG_SEGS; seg++)
+   {
+      if(LogHeader(seg, &seq) && (!found || (short)(seq - LogSeq) > 0))
+      {
+         found  = 1;
+         LogSeg = seg;
+         LogSeq = seq;
+      }
+   }
+
+   if(found)
+   {
+      addr   = LOG_ADDR(LogSeg);
+      LogPos = LOG_HDR;
+      while(LogPos < LOG_SEG)
+      {
+         len = FLASH8(addr + LogPos);
+         if(len == 0xFF)
+            break;
+         if(len < LOG_REC_HDR + 2 || LogPos + len > LOG_SEG)
+         {
+            LogPos = LOG_SEG;    /* Damaged, go on in the next segment */
+            break;
+         }
+         LogPos += len;
+      }
+   }
+
+   LogBuf[1] = 0;
+}
+
+/**
+ *  @fn LogNext
+ *  @brief The function erases the next segment and writes its header
+ *
+ *  @param none
+ *  @return none
+ */
+static void LogNext(void)
+{
+   unsigned char hdr[LOG_HDR];
+
+   LogSeg = (LogSeg + 1 < LOG_SEGS) ? LogSeg + 1 : 0;
+   LogSeq++;
+
+   hdr[0] = LOG_MAGIC;
+   hdr[1] = (unsigned char)LogSeq;
+   hdr[2] = (unsigned char)(LogSeq >> 8);
+   hdr[3] = LOG_CHECK(hdr[1], hdr[2]);
+   FlashErase(LOG_ADDR(LogSeg));
+   FlashWrite(LOG_ADDR(LogSeg), hdr, LOG_HDR);
+   LogPos = LOG_HDR;
+}
+
+/**
+ *  @fn LogVarint
+ *  @brief The function appends a varint to the batch
+ *
+ *  @param val    value
+ *  @return none
+ */
+static void LogVarint(unsigned long val)
+{
+   while(val >= 0x80)
+   {
+      LogBuf[LogLen++] = (unsigned char)val | 0x80;
+      val >>= 7;
+   }
+   LogBuf[LogLen++] = (unsigned char)val;
+}
+
+/**
+ *  @fn LogZigzag
+ *  @brief The function maps a signed difference on a small unsigned value
+ *
+ *  @param d      difference (-LOG_VMAX to LOG_VMAX)
+ *  @return 0, 1, 2 ... for 0, -1, 1 ...
+ */
+static unsigned long LogZigzag(long d)
+{
+   return ((unsigned long)d << 1) ^ (unsigned long)(d >> 31);
+}
+
+/**
+ *  @fn LogStart
+ *  @brief The function starts a new run, its first record is marked
+ *
+ *  @param none
+ *  @return none
+ */
+void LogStart(void)
+{
+   LogFlush();
+   LogFlags    = LOG_RUN;
+   Log_samples = 0;
+   Log_bytes   = 0;
+}
+
+/**
+ *  @fn LogAdd
+ *  @brief The function adds a reading to the batch
+ *
+ *  The batch is written first if the sample may not fit, or if the interval
+ *  can not be encoded (the time base went back or a too long pause).
+ *
+ *  @param stamp  time base of the reading
+ *  @param rpm10  RPM x 10
+ *  @return none
+ */
+void LogAdd(unsigned long stamp, unsigned long rpm10)
+{
+   unsigned long dt = stamp - LogStamp;
+   unsigned long tag;
+
+   if(rpm10 > LOG_VMAX)
+      rpm10 = LOG_VMAX;
+
+   if(LogBuf[1] &&
+      (LogLen + LOG_SAMPLE_MAX + 1 > LOG_BATCH || LogBuf[1] == 0xFF || dt > LOG_VMAX))
+      LogFlush();
+
+   if(LogBuf[1] == 0)
+   {
+      LogBuf[2] = LogFlags;
+      LogBuf[3] = (unsigned char)stamp;
+      LogBuf[4] = (unsigned char)(stamp >> 8);
+      LogBuf[5] = (unsigned char)(stamp >> 16);
+      LogBuf[6] = (unsigned char)(stamp >> 24);
+      LogLen    = LOG_REC_HDR;
+      LogFlags  = 0;
+      LogDt     = 0;
+      LogVarint(rpm10);
+   }
+   else
+   {
+      tag = LogZigzag((long)(rpm10 - LogVal)) << 1;
+      if(dt != LogDt)
+         tag |= 1;
+      LogVarint(tag);
+      if(dt != LogDt)
+      {
+         LogVarint(LogZigzag((long)(dt - LogDt)));
+         LogDt = dt;
+      }
+   }
+
+   LogBuf[1]++;
+   LogStamp = stamp;
+   LogVal   = rpm10;
+   Log_samples++;
+}
+
+/**
+ *  @fn LogFlush
+ *  @brief The function writes the batch in the flash
+ *
+ *  @param none
+ *  @return none
+ */
+void LogFlush(void)
+{
+   unsigned char sum = 0;
+   unsigned char i;
+
+   if(LogBuf[1] == 0)
+      return;
+
+   LogBuf[0] = LogLen + 1;
+   for(i = 0; i < LogLen; i++)
+      sum += LogBuf[i];
+   LogBuf[LogLen] = sum;
+
+   if(LogPos + LogLen + 1 > LOG_SEG)
+      LogNext();
+   FlashWrite(LOG_ADDR(LogSeg) + LogPos, LogBuf, LogLen + 1);
+   LogPos    += LogLen + 1;
+   Log_bytes += LogLen + 1;
+   LogBuf[1]  = 0;
+   LogLen     = 0;
+}
+
+/**
+ *  @fn LogSend
+ *  @brief The function queues bytes on the telemetry UART, waiting for room
+ *
+ *  @param buf    bytes
+ *  @param len    number of bytes (up to LOG_CHUNK)
+ *  @return none
+ */
+static void LogSend(const unsigned char *buf, unsigned char len)
+{
+   while(!TelemPut(buf, len))
+      SysSleep(MODE_LPM3);
+}
+
+/**
+ *  @fn LogDump
+ *  @brief The function sends the whole log on the telemetry UART
+ *
+ *  About 17 s at 9600 baud for the full area.
+ *
+ *  @param none
+ *  @return none
+ */
+void LogDump(void)
+{
+   unsigned char buf[LOG_CHUNK];
+   unsigned int  addr, pos;
+   unsigned short seq;
+   unsigned char seg, i, k;
+   unsigned char sum;
+   unsigned char num = 0;
+
+   LogFlush();
+
+   // Oldest first : the segment after the one being written
+   for(k = 1; k <= LOG_SEGS; k++)
+   {
+      seg = (LogSeg + k < LOG_SEGS) ? LogSeg + k : LogSeg + k - LOG_SEGS;
+      if(!LogHeader(seg, &seq))
+         continue;
+
+      buf[0] = LOG_DUMP_SYNC0;
+      buf[1] = LOG_DUMP_SEG;
+      buf[2] = seg;
+      LogSend(buf, 3);
+
+      addr = LOG_ADDR(seg);
+      sum  = 0;
+      for(pos = 0; pos < LOG_SEG; pos += LOG_CHUNK)
+      {
+         for(i = 0; i < LOG_CHUNK; i++)
+         {
+            buf[i] = FLASH8(addr + pos + i);
+            sum   += buf[i];
+         }
+         LogSend(buf, LOG_CHUNK);
+      }
+      LogSend(&sum, 1);
+      num++;
+   }
+
+   buf[0] = LOG_DUMP_SYNC0;
+   buf[1] = LOG_DUMP_END;
+   buf[2] = num;
+   LogSend(buf, 3);
+}
+
+/**
+ *  @fn Logger
+ *  @brief The function logs the readings until the joystick is pressed
+ *
+ *  The summary then offers the dump of the log (joystick left).
+ *
+ *  @param none
+ *  @return none
+ */
+void Logger(void)
+{
+   /*
+    *  Max length
+    * "12345678901234"
+    */
+   unsigned long rpm10 = 0;
+   unsigned char seq = Rpm_seq;
+   unsigned char redraw = 0;
+   unsigned char key;
+   RpmSnap snap;
+
+   LogStart();
+
+   LCDClear();
+   LCDStr ( 0, (unsigned char *)" Logging" );
+   LCDStr ( 1, (unsigned char *)" RPM =" );
+   LCDStr ( 2, (unsigned char *)" Samples:" );
+   LCDStr ( 3, (unsigned char *)" Bytes  :" );
+   LCDStr ( 4, (unsigned char *)" Segment:" );
+   LCDStr ( 5, (unsigned char *)" Press to stop" );
+   LCDUpdate();
+
+   //until the joystick is pressed
+   while(KeyGet() != (KEY_ID_PUSH | KEY_EV_PRESS))
+   {
+      if(RpmRead(&snap, &seq))
+      {
+         rpm10 = RpmTenths(&snap);
+         LogAdd(snap.stamp, rpm10);
+         TelemSend(&snap, rpm10);
+         redraw = 1;
+      }
+
+      if(redraw && !LCDBusy())
+      {
+         LCDNum ( 6, 1, rpm10, 8, 1 );
+         LCDNum ( 9, 2, Log_samples, 5, 0 );
+         LCDNum ( 9, 3, Log_bytes + LogLen, 5, 0 );
+         LCDNum ( 9, 4, LogSeg, 5, 0 );
+         LCDUpdate();
+         redraw = 0;
+      }
+
+      // Sleep until a new reading or a key
+      SysSleep(MODE_LPM3);
+   }
+
+   LogFlush();
+
+   for(;;)
+   {
+      LCDClear();
+      LCDStr ( 0, (unsigned char *)" Log stopped" );
+      LCDStr ( 1, (unsigned char *)" Samples:" );
+      LCDNum ( 9, 1, Log_samples, 5, 0 );
+      LCDStr ( 2, (unsigned char *)" Bytes  :" );
+      LCDNum ( 9, 2, Log_bytes, 5, 0 );
+      LCDStr ( 4, (unsigned char *)" Left : dump" );
+      LCDStr ( 5, (unsigned char *)" Push : exit" );
+      LCDUpdate();
+
+      while((key = KeyGet()) != (KEY_ID_PUSH | KEY_EV_PRESS) &&
+            key != (KEY_ID_LEFT | KEY_EV_PRESS))
+         SysSleep(MODE_LPM3);
+
+      if(key == (KEY_ID_PUSH | KEY_EV_PRESS))
+         break;
+
+      LCDClear();
+      LCDStr ( 0, (unsigned char *)" Dumping log" );
+      LCDUpdate();
+      LogDump();
+   }
+}
+
+/*
+ *  This code is documented using DoxyGen
+ *  (http://www.stack.nl/~dimitri/doxygen/index.html)
+ */
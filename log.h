@@ -0,0 +1,48 @@
+/**
+ *  @file log.h
+ *  @author TheFwGuy
+ *  @version 1.0
+ *  @date October 2026
+ *  @brief Header file for the log.c
+ */
+#ifndef __LOG_H
+#define __LOG_H
+
+/* definitions */
+
+// FLASH AREA (the firmware image must end below LOG_BASE, checked by 'make')
+#define LOG_BASE        0xC000   /* First segment of the log */
+#define LOG_SEGS        31       /* Segments, up to 0xFDFF */
+#define LOG_SEG         512      /* Segment size, FLASH_SEG */
+
+// SEGMENT HEADER : magic, sequence number (u16), check
+#define LOG_MAGIC       0x4C
+#define LOG_HDR         4
+#define LOG_CHECK(lo, hi)  ((unsigned char)~(LOG_MAGIC + (lo) + (hi)))
+
+// RECORD : len, samples, flags, stamp (u32), samples, checksum
+#define LOG_BATCH       120      /* Largest record, RAM batch */
+#define LOG_REC_HDR     7
+#define LOG_RUN         0x01     /* Flags : first record of a run */
+#define LOG_SAMPLE_MAX  10       /* Largest encoded sample, two 5 byte varints */
+#define LOG_VMAX        0x3FFFFFFFUL   /* Largest value and interval */
+
+// DUMP (USART1) : LOG_DUMP_SYNC slot, LOG_SEG bytes, checksum ... LOG_DUMP_END
+#define LOG_DUMP_SYNC0  0xA5
+#define LOG_DUMP_SEG    0x5B
+#define LOG_DUMP_END    0x5C
+
+/*
+ *  Function prototypes
+ */
+void LogInit(void);
+void LogStart(void);
+void LogAdd(unsigned long stamp, unsigned long rpm10);
+void LogFlush(void);
+void LogDump(void);
+void Logger(void);
+
+extern unsigned long Log_samples;
+extern unsigned long Log_bytes;
+
+#endif
@@ -12,23 +12,34 @@
  *  This program is executed on a Olimex MSP430F169LCD board and compiled using Mspgcc 4.4.3
  *
  *  Pinout :
- *    P1.1   Hall sensor input
- *    P1.4   Joystick direction
- *    P1.5   Joystick direction
- *    P1.6   Joystick direction
- *    P1.7   Joystick direction
- *    P2.0   Joystick pushbutton
+ *    P1.1   Hall sensor input (TA0 capture input in period mode)
+ *    P1.4   Joystick direction (port interrupt, debounced by the WDT interval timer)
+ *    P1.5   Joystick direction (port interrupt, debounced by the WDT interval timer)
+ *    P1.6   Joystick direction (port interrupt, debounced by the WDT interval timer)
+ *    P1.7   Joystick direction (port interrupt, debounced by the WDT interval timer)
+ *    P2.0   Joystick pushbutton (port interrupt, debounced by the WDT interval timer)
  *    P2.1   Status LED - toggle at every Hal sensor signal
  *    P2.2   Status clock - 2 sec. period
- *    P2.3   Debug pin
+ *    P2.3   Debug pin - toggled at every boot stage, high while measuring
+ *    P2.4   Trip output - high past the set speed limit
+ *    P3.6   Telemetry TX (USART1 UART, 9600 8N1, binary frames, see telem.c)
+ *    P4.7   Hall sensor input, wired in parallel with P1.1 (TBCLK, hardware count mode)
  */
 
-#include <stdio.h>
 #include <string.h>
 #include "system.h"
 #include "lcd_new.h"
-#include <io.h>
-#include <signal.h>
+#include "rpm.h"
+#include "keys.h"
+#include "profile.h"
+#include "calib.h"
+#include "stats.h"
+#include "telem.h"
+#include "log.h"
+#include "param.h"
+#include "boot.h"
+#include "clock.h"
+#include "hal.h"
 /*
  *  Global defines
  */
@@ -39,14 +50,17 @@ unsigned char i = 0;
 
 // Measurement variables
 unsigned char NumMagnets = 2; /* Number of magnets (1 to 8 )*/
-unsigned char AcqSecTime = 1; /* Acquisition time in seconds (1 to 10) */
+unsigned char AcqSecTime = 1; /* Acquisition window in seconds (1 to 10) */
+unsigned char RefreshBins = BINS_PER_SEC; /* Bins between readings (1 to 8) */
+unsigned char MeasMode = MEAS_GATE; /* Measurement mode (gate or period) */
+unsigned char GlitchMode = FILTER_FIXED; /* Hall glitch filter */
+unsigned char TripMode = TRIP_OFF; /* Speed trip (off, over or under) */
+unsigned short TripRpm = 3000; /* Speed trip threshold in RPM */
+unsigned short MagnetCal[MAX_MAGNETS]; /* Magnet spacing weights (Q15, CAL_ONE = even) */
+unsigned char CalMagnets = 0; /* Magnets of the MagnetCal table (0 = none) */
+unsigned char StatTime = 1; /* Statistics interval (index in StatSecs) */
+unsigned char AutoStart = 0; /* Measure at power up, without the menu */
 
-unsigned short Rpm_cnt;	     /* RPM counter */
-short Rpm_display;              /* RPM display value */
-unsigned char  Rpm_show;       /* Flag to display the result */
-
-// simple delay
-void DelayN(unsigned long a) { while (--a!=0); }
 void SetParam(void);
 
 /**
@@ -61,14 +75,10 @@ unsigned char Menu(void)
 {
    unsigned char locPos = 1;
    unsigned char display = 1;
-   char press_up   = 1;
-   char press_down = 1;
-
-   //Wait if pushbutton is pressed
-   while((P2IN&BIT0) == 0);
+   unsigned char key;
 
    // loop for choose
-   do
+   for(;;)
    {
       /*
        *  Max length
@@ -79,43 +89,50 @@ unsigned char Menu(void)
          LCDClear();
          LCDStr ( 0, (unsigned char *)" Set " );
          LCDStr ( 1, (unsigned char *)" Measure " );
+         LCDStr ( 2, (unsigned char *)" Profile " );
+         LCDStr ( 3, (unsigned char *)" Calibrate " );
+         LCDStr ( 4, (unsigned char *)" Statistics " );
+         LCDStr ( 5, (unsigned char *)" Log " );
          LCDStr ( locPos-1, (unsigned char *)">" );
          LCDUpdate();
          display = 0;
       }
 
-      // Up
-      if((!(P1IN&BIT6))&&(press_up==1))
+      key = KeyGet();
+      if(key == KEY_NONE)
       {
-         locPos--;
-         if(locPos<1) locPos = 1;
-
-         press_up = 0;
-         display = 1;
-      }
-      if((P1IN&BIT6)&&(press_up==0))
-      {
-         press_up = 1;
+         // Nothing to do until a key event
+         SysSleep(MODE_LPM3);
+         continue;
       }
+      if(KEY_EV(key) == KEY_EV_RELEASE)
+         continue;
 
-      // Down
-      if((!(P1IN&BIT5))&&(press_down==1))
+      switch(KEY_ID(key))
       {
-         locPos++;
-         if(locPos>2) locPos = 2;
-
-         press_down = 0;
-         display = 1;
-      }
+         case KEY_ID_UP:
+            if(locPos > 1)
+            {
+               locPos--;
+               display = 1;
+            }
+            break;
 
-      if((P1IN&BIT5)&&(press_down==0))
-      {
-        press_down = 1;
-      }
+         case KEY_ID_DOWN:
+            if(locPos < 6)
+            {
+               locPos++;
+               display = 1;
+            }
+            break;
 
-  } while(P2IN&BIT0);
+         case KEY_ID_PUSH:
+            return (locPos);
 
-  return (locPos);
+         default:
+            break;
+      }
+   }
 }
 
 /**
@@ -131,37 +148,76 @@ void Measure(void)
     *  Max length
     * "12345678901234"
     */
-   char tmpBuf[20];
-   int rpm;
+   unsigned long rpm10;
+   unsigned char seq = Rpm_seq;
+   RpmSnap snap;
 
    LCDClear();
    LCDStr ( 0, (unsigned char *)" Measuring " );
-   sprintf(tmpBuf, " Magnets : %u", NumMagnets);
-   LCDStr ( 1, (unsigned char *)tmpBuf );
-   sprintf(tmpBuf, " Timer (s): %u", AcqSecTime);
-   LCDStr ( 2, (unsigned char *)tmpBuf );
+   LCDStr ( 1, (unsigned char *)" Magnets :" );
+   LCDNum ( 10, 1, NumMagnets, 2, 0 );
+   if(MeasMode == MEAS_PERIOD)
+   {
+      LCDStr ( 2, (unsigned char *)" Mode : Period" );
+      LCDStr ( 3, (unsigned char *)" Ticks =" );
+   }
+   else if(MeasMode == MEAS_AUTO)
+   {
+      LCDStr ( 2, (unsigned char *)" Mode : Auto" );
+      LCDStr ( 3, (unsigned char *)" Gate ms =" );
+   }
+   else
+   {
+      LCDStr ( 2, (unsigned char *)" Window (s):" );
+      LCDNum ( 12, 2, AcqSecTime, 2, 0 );
+      LCDStr ( 3, (unsigned char *)" Count =" );
+   }
+   LCDStr ( 4, (unsigned char *)" RPM =" );
+   if(GlitchMode != FILTER_OFF && MeasMode != MEAS_HWCOUNT)
+      LCDStr ( 5, (unsigned char *)" Reject =" );
    LCDUpdate();
 
    P2OUT |= BIT3;   // Set debug pin high
 
-   //if joystick is not pressed
-   while((P2IN&BIT0) == 1)
+   //until the joystick is pressed
+   while(KeyGet() != (KEY_ID_PUSH | KEY_EV_PRESS))
    {
       /* Display the RPM here */
-      if(Rpm_show == 1)
+      if(RpmRead(&snap, &seq))
       {
-         rpm = (Rpm_display / NumMagnets) * (60 / AcqSecTime);
-         /*
-          *  Refresh display value
-          */
-         sprintf(tmpBuf, " Raw count = %d   ", Rpm_display);
-         LCDStr ( 3, (unsigned char *)tmpBuf);
-         sprintf(tmpBuf, " RPM = %d   ", rpm);
-         LCDStr ( 4, (unsigned char *)tmpBuf);
+         BootMark(BOOT_READING);
+         rpm10 = RpmTenths(&snap);
+         TelemSend(&snap, rpm10);
+         if(MeasMode == MEAS_PERIOD)
+         {
+            /*
+             *  Refresh display value at every edge
+             */
+            LCDNum ( 8, 3, snap.gate, 6, 0 );
+         }
+         else if(MeasMode == MEAS_AUTO)
+         {
+            /*
+             *  Show the gate chosen for the edge rate, in ms
+             */
+            LCDNum ( 10, 3, (snap.gate * 125 + 2048) >> 12, 4, 0 );
+         }
+         else
+            LCDNum ( 8, 3, snap.count, 6, 0 );
+         LCDNum ( 6, 4, rpm10, 8, 1 );
+         if(Rpm_stall)
+            LCDStr ( 0, (unsigned char *)" Stopped   " );
+         else if(Rpm_trip)
+            LCDStr ( 0, (unsigned char *)" Tripped   " );
+         else
+            LCDStr ( 0, (unsigned char *)" Measuring " );
+         if(GlitchMode != FILTER_OFF && MeasMode != MEAS_HWCOUNT)
+            LCDNum ( 9, 5, Rpm_reject, 5, 0 );
          LCDUpdate();
-
-         Rpm_show = 0;
       }
+
+      // Sleep until a new reading or a key
+      SysSleep(MODE_LPM3);
    }
 
    P2OUT &= ~BIT3;   // Set debug pin low
@@ -183,100 +239,90 @@ int main( void )
    /**** INITIALIZATION ****/
    WDTCTL = WDTPW + WDTHOLD;             // Stop watchdog timer
 
-   Rpm_cnt       = 0;
-   Rpm_display   = 0;
-   Rpm_show      = 0;
-
    // Initialize I/O
    InitPeriph();
 
-   // Frequency
-   InitFreq();
-   InitTimer();
+   // Frequency, the 32kHz crystal starts while the rest is set up
+   FreqStart();
+   BootStart();
+
+   // Saved settings, before the timers are set for the measurement mode
+   ParamLoad();
+   BootMark(BOOT_PARAM);
 
-   // LCD init
+   // LCD init (SMCLK only)
    LCDInit();
    LCDContrast(0x45);
+   BootMark(BOOT_LCD);
+
+   // Telemetry UART, after the LCD (ME2)
+   TelemInit();
+
+   // End of the flash log
+   LogInit();
+
+   // Joystick interrupts
+   KeyInit();
+   BootMark(BOOT_PERIPH);
+
+   // The time base needs a stable ACLK
+   BootXtal();
+   BootMark(BOOT_XTAL);
+
+   // Boot stopwatch done, the DCO can leave CLK_NORMAL (LCD idle)
+   ClockSet(CLK_MAIN);
+   InitTimer();
 
    eint();  /* Enable interrupts */
+   BootMark(BOOT_TIMER);
+
+   // Straight to the measurement with the saved settings
+   if(AutoStart)
+   {
+      RpmStart();
+      Measure();
+   }
 
    for(;;)
    {
       // Show main menu
       menuSelection = Menu();
 
-      //Wait if pushbutton is pressed
-      while((P2IN&BIT0) == 0);
-      DelayN(1000);
-
       switch(menuSelection)
       {
          default:
             menuSelection = 1;
          case 1:     /* Set */
             SetParam();
-            InitTimer();  /* Reinitialize timer for possible new AcqSetTime */
+            ParamSave();
+            InitTimer();  /* Reinitialize timer for possible new AcqSetTime or mode */
             break;
 
          case 2:     /* Measure */
-            Rpm_display = 0;
-            Rpm_cnt     = 0;
-
+            RpmStart();
             Measure();
             break;
-      }
-   }
-}
 
-/**
- * Timer_A
- * @brief Timer A0 interrupt service routine
- *
- * This function handle the Timer A interrupt, in order to perform
- *  time related operations.
- *
- * The timer is set to generate an interrupt every second.
- *
- * @param none
- * @return None
- */
-interrupt(TIMERA0_VECTOR) Timer_A (void)
-{
-   /*
-    *  1 second interrupt expired
-    *  Copy the counter in the display value and reset the counter
-    *  Set flag for display value
-    */
-   Rpm_display = Rpm_cnt;
-   Rpm_cnt     = 0;
-   Rpm_show    = 1;
-   P2OUT ^= BIT2;   // toggle status clock
-}
+         case 3:     /* Profile */
+            Profile();
+            InitTimer();  /* Back to the measurement mode */
+            break;
 
-/**
- * I/O Port 1
- * @brief I/O port 1 interrupt service routine
- *
- * This function handle the I/O Port 1 interrupt.
- *
- * @param none
- * @return None
- */
-interrupt(PORT1_VECTOR) PORT1_ISR(void)
-{
-   if(P1IFG & RPM_IN)
-   {
-      /*
-       *  Interrupt on Pin 1.1 !
-       *  Be sure is not a spike !
-       */
-      if(P1IN & RPM_IN)
-      {
-         P2OUT ^= BIT1;   // toggle status LED
-         Rpm_cnt++;   /* Increment counter */
-      }
+         case 4:     /* Calibrate */
+            Calibrate();
+            ParamSave();  /* New magnet spacing table */
+            break;
 
-      P1IFG &= ~RPM_IN;  /* Reset I/O interrupt on P1.1 */
+         case 5:     /* Statistics */
+            RpmStart();
+            Stats();
+            break;
+
+         case 6:     /* Log */
+            RpmStart();
+            Logger();
+            break;
+      }
    }
 }
 
@@ -0,0 +1,235 @@
+/**
+ *  @file param.c
+ *  @author TheFwGuy
+ *  @version 1.0
+ *  @date October 2026
+ *  @brief Settings kept in the information memory
+ *
+ *  The settings are saved in one of the PARAM_SLOTS slots of the two
+ *  information segments, each save in the slot after the last one, with
+ *  an increasing sequence number. A segment is erased only when the saves
+ *  get to its first slot, and the newest copy is then in the other
+ *  segment : a power loss during a save leaves the previous settings. At
+ *  boot the newest slot with the right version, a good checksum and
+ *  settings in range is loaded, otherwise the defaults of main.c are kept.
+ *  A save identical to the newest copy writes nothing.
+ */
+
+#include "system.h"
+#include "rpm.h"
+#include "stats.h"
+#include "flash.h"
+#include "param.h"
+#include "hal.h"
+
+extern unsigned char NumMagnets; /* Number of magnets */
+extern unsigned char AcqSecTime; /* Acquisition time in seconds */
+extern unsigned char RefreshBins; /* Bins between readings */
+extern unsigned char MeasMode;   /* Measurement mode */
+extern unsigned char GlitchMode; /* Hall glitch filter */
+extern unsigned char TripMode;   /* Speed trip */
+extern unsigned short TripRpm;   /* Speed trip threshold */
+extern unsigned short MagnetCal[MAX_MAGNETS]; /* Magnet spacing weights */
+extern unsigned char CalMagnets; /* Magnets of the MagnetCal table */
+extern unsigned char StatTime;   /* Statistics interval */
+extern unsigned char AutoStart;  /* Measure at power up */
+
+#define PARAM_ADDR(slot)   (PARAM_BASE + (unsigned int)(slot) * PARAM_SLOT)
+#define PARAM_PER_SEG      (FLASH_INFO_SEG / PARAM_SLOT)
+
+unsigned char  ParamSlot = PARAM_SLOTS - 1;   /* Newest slot */
+unsigned short ParamSeq  = 0xFFFF;            /* Its sequence number */
+
+/**
+ *  @fn ParamSum
+ *  @brief The function computes the Fletcher-16 checksum of a slot
+ *
+ *  @param buf    slot
+ *  @return checksum
+ */
+static unsigned short ParamSum(const unsigned char *buf)
+{
+   unsigned short s1 = 0, s2 = 0;
+   unsigned char i;
+
+   for(i = 0; i < PARAM_LEN - 2; i++)
+   {
+      s1 = (s1 + buf[i]) % 255;
+      s2 = (s2 + s1) % 255;
+   }
+   return (s2 << 8) | s1;
+}
+
+/**
+ *  @fn ParamPack
+ *  @brief The function builds the slot of the current settings
+ *
+ *  @param buf    slot (PARAM_LEN bytes)
+ *  @param seq    sequence number
+ *  @return none
+ */
+static void ParamPack(unsigned char *buf, unsigned short seq)
+{
+   unsigned short sum;
+   unsigned char i;
+
+   buf[0]  = PARAM_MAGIC;
+   buf[1]  = PARAM_VERSION;
+   buf[2]  = (unsigned char)seq;
+   buf[3]  = (unsigned char)(seq >> 8);
+   buf[4]  = NumMagnets;
+   buf[5]  = AcqSecTime;
+   buf[6]  = RefreshBins;
+   buf[7]  = MeasMode;
+   buf[8]  = GlitchMode;
+   buf[9]  = TripMode;
+   buf[10] = (unsigned char)TripRpm;
+   buf[11] = (unsigned char)(TripRpm >> 8);
+   buf[12] = CalMagnets;
+   buf[13] = StatTime;
+   buf[14] = AutoStart;
+   for(i = 0; i < MAX_MAGNETS; i++)
+   {
+      buf[15 + 2 * i] = (unsigned char)MagnetCal[i];
+      buf[16 + 2 * i] = (unsigned char)(MagnetCal[i] >> 8);
+   }
+   sum = ParamSum(buf);
+   buf[PARAM_LEN - 2] = (unsigned char)sum;
+   buf[PARAM_LEN - 1] = (unsigned char)(sum >> 8);
+}
+
+/**
+ *  @fn ParamValid
+ *  @brief The function checks a slot read from the flash
+ *
+ *  @param buf    slot
+ *  @return 1 if the slot can be loaded
+ */
+static unsigned char ParamValid(const unsigned char *buf)
+{
+   unsigned short sum = buf[PARAM_LEN - 2] | ((unsigned short)buf[PARAM_LEN - 1] << 8);
+   unsigned short cal;
+   unsigned char i;
+
+   if(buf[0] != PARAM_MAGIC || buf[1] != PARAM_VERSION || sum != ParamSum(buf))
+      return 0;
+
+   if(buf[4] < 1 || buf[4] > MAX_MAGNETS || buf[5] < 1 || buf[5] > MAX_ACQ_TIME ||
+      buf[6] < 1 || buf[6] > BINS_PER_SEC || (buf[6] & (buf[6] - 1)) ||
+      buf[7] >= MEAS_NUM || buf[8] >= FILTER_NUM || buf[9] >= TRIP_NUM ||
+      (buf[10] | ((unsigned short)buf[11] << 8)) > MAX_TRIP_RPM ||
+      buf[12] > MAX_MAGNETS || buf[13] >= STAT_TIMES || buf[14] > 1)
+      return 0;
+
+   for(i = 0; i < buf[12]; i++)
+   {
+      cal = buf[15 + 2 * i] | ((unsigned short)buf[16 + 2 * i] << 8);
+      if(cal <= CAL_MIN || cal >= CAL_MAX)
+         return 0;
+   }
+   return 1;
+}
+
+/**
+ *  @fn ParamRead
+ *  @brief The function copies a slot from the flash
+ *
+ *  @param slot   slot
+ *  @param buf    copy (PARAM_LEN bytes)
+ *  @return none
+ */
+static void ParamRead(unsigned char slot, unsigned char *buf)
+{
+   unsigned int  addr = PARAM_ADDR(slot);
+   unsigned char i;
+
+   for(i = 0; i < PARAM_LEN; i++)
+      buf[i] = FLASH8(addr + i);
+}
+
+/**
+ *  @fn ParamLoad
+ *  @brief The function loads the newest valid settings
+ *
+ *  @param none
+ *  @return none
+ */
+void ParamLoad(void)
+{
+   unsigned char buf[PARAM_LEN];
+   unsigned short seq;
+   unsigned char slot, i;
+   unsigned char found = 0;
+
+   for(slot = 0; slot < PARAM_SLOTS; slot++)
+   {
+      ParamRead(slot, buf);
+      seq = buf[2] | ((unsigned short)buf[3] << 8);
+      if(ParamValid(buf) && (!found || (short)(seq - ParamSeq) > 0))
+      {
+         found     = 1;
+         ParamSlot = slot;
+         ParamSeq  = seq;
+      }
+   }
+   if(!found)
+      return;
+
+   ParamRead(ParamSlot, buf);
+   NumMagnets  = buf[4];
+   AcqSecTime  = buf[5];
+   RefreshBins = buf[6];
+   MeasMode    = buf[7];
+   GlitchMode  = buf[8];
+   TripMode    = buf[9];
+   TripRpm     = buf[10] | ((unsigned short)buf[11] << 8);
+   CalMagnets  = buf[12];
+   StatTime    = buf[13];
+   AutoStart   = buf[14];
+   for(i = 0; i < MAX_MAGNETS; i++)
+      MagnetCal[i] = buf[15 + 2 * i] | ((unsigned short)buf[16 + 2 * i] << 8);
+}
+
+/**
+ *  @fn ParamSave
+ *  @brief The function saves the settings if they changed
+ *
+ *  @param none
+ *  @return none
+ */
+void ParamSave(void)
+{
+   unsigned char buf[PARAM_LEN];
+   unsigned char old[PARAM_LEN];
+   unsigned char slot, i;
+
+   // Same settings as the newest copy : nothing to write
+   ParamPack(buf, ParamSeq);
+   ParamRead(ParamSlot, old);
+   for(i = 0; i < PARAM_LEN && buf[i] == old[i]; i++)
+      ;
+   if(i == PARAM_LEN)
+      return;
+
+   slot = (ParamSlot + 1) % PARAM_SLOTS;
+   if(slot % PARAM_PER_SEG)
+   {
+      // Slot not blank, left over by a power loss : first slot of the next segment
+      for(i = 0; i < PARAM_SLOT && FLASH8(PARAM_ADDR(slot) + i) == 0xFF; i++)
+         ;
+      if(i < PARAM_SLOT)
+         slot = (slot / PARAM_PER_SEG + 1) * PARAM_PER_SEG % PARAM_SLOTS;
+   }
+   if(slot % PARAM_PER_SEG == 0)
+      FlashErase(PARAM_ADDR(slot));
+
+   ParamPack(buf, ParamSeq + 1);
+   FlashWrite(PARAM_ADDR(slot), buf, PARAM_LEN);
+   ParamSlot = slot;
+   ParamSeq++;
+}
+
+/*
+ *  This code is documented using DoxyGen
+ *  (http://www.stack.nl/~dimitri/doxygen/index.html)
+ */
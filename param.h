@@ -0,0 +1,31 @@
+/**
+ *  @file param.h
+ *  @author TheFwGuy
+ *  @version 1.0
+ *  @date October 2026
+ *  @brief Header file for the param.c
+ */
+#ifndef __PARAM_H
+#define __PARAM_H
+
+/* definitions */
+
+// INFORMATION MEMORY : segment B (0x1000) then segment A (0x1080)
+#define PARAM_BASE      0x1000
+#define PARAM_SLOT      64       /* Bytes of a slot */
+#define PARAM_SLOTS     4        /* Slots, two per segment */
+
+// SLOT : magic, version, sequence number (u16), settings, Fletcher-16
+#define PARAM_MAGIC     0x53
+#define PARAM_VERSION   1        /* Change with the layout of the settings */
+#define PARAM_HDR       4
+#define PARAM_DATA      27       /* Bytes of the settings */
+#define PARAM_LEN       (PARAM_HDR + PARAM_DATA + 2)
+
+/*
+ *  Function prototypes
+ */
+void ParamLoad(void);
+void ParamSave(void);
+
+#endif
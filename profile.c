@@ -0,0 +1,270 @@
+/**
+ *  @file profile.c
+ *  @author TheFwGuy
+ *  @version 1.0
+ *  @date October 2026
+ *  @brief Spin-up and coast-down profile of the rotor
+ *
+ *  The Hall edges are timestamped by the edge capture of rpm.c and
+ *  processed here, in the main loop, as they come out of the ring :
+ *    - instantaneous RPM at every edge, over the last revolution
+ *    - acceleration over the last revolution, highest and lowest (coast)
+ *    - peak RPM and the time from the first edge to it
+ *    - time from the first edge to 90% of the peak, from a history of the
+ *      peak speed that halves its rate when full (PROF_HIST entries), so
+ *      within one history step
+ *  The figures are shown live and as a summary at the end of the run.
+ */
+
+#include "system.h"
+#include "lcd_new.h"
+#include "rpm.h"
+#include "keys.h"
+#include "profile.h"
+#include "hal.h"
+
+extern unsigned char NumMagnets; /* Number of magnets */
+
+unsigned long  ProfStamp[MAX_MAGNETS]; /* Timestamps of the last edges */
+unsigned long  ProfRpm[MAX_MAGNETS];   /* RPM x 10 at the last edges (0 = none) */
+unsigned char  ProfIdx;                /* Next position in the edge ring */
+unsigned char  ProfNum;                /* Valid entries in the edge ring */
+
+unsigned long  ProfCount;        /* Edges processed */
+unsigned long  ProfFirst;        /* Timestamp of the first edge */
+unsigned long  ProfLast;         /* Last instantaneous RPM x 10 */
+unsigned long  ProfPeak;         /* Peak RPM x 10 */
+unsigned long  ProfPeakT;        /* Ticks from the first edge to the peak */
+long           ProfAcc;          /* Highest acceleration, RPM/s */
+long           ProfDec;          /* Lowest acceleration, RPM/s */
+
+unsigned long  ProfHistT[PROF_HIST];   /* Ticks from the first edge */
+unsigned long  ProfHistRpm[PROF_HIST]; /* Peak RPM x 10 at that time */
+unsigned char  ProfHistNum;            /* Entries in the history */
+unsigned short ProfStride;             /* New peaks per history entry */
+unsigned short ProfSkip;               /* New peaks since the last entry */
+
+/**
+ *  @fn ProfReset
+ *  @brief The function clears the profile before a run
+ *
+ *  @param none
+ *  @return none
+ */
+static void ProfReset(void)
+{
+   unsigned char i;
+
+   for(i = 0; i < MAX_MAGNETS; i++)
+      ProfRpm[i] = 0;
+   ProfIdx     = 0;
+   ProfNum     = 0;
+   ProfCount   = 0;
+   ProfLast    = 0;
+   ProfPeak    = 0;
+   ProfPeakT   = 0;
+   ProfAcc     = 0;
+   ProfDec     = 0;
+   ProfHistNum = 0;
+   ProfStride  = 1;
+   ProfSkip    = 0;
+}
+
+/**
+ *  @fn ProfHist
+ *  @brief The function records a new peak speed in the history
+ *
+ *  When the history is full every other entry is dropped and only one new
+ *  peak out of twice as many is recorded from then on.
+ *
+ *  @param t      ticks from the first edge
+ *  @param rpm10  new peak RPM x 10
+ *  @return none
+ */
+static void ProfHist(unsigned long t, unsigned long rpm10)
+{
+   unsigned char i;
+
+   if(++ProfSkip < ProfStride)
+      return;
+   ProfSkip = 0;
+
+   if(ProfHistNum == PROF_HIST)
+   {
+      for(i = 0; i < PROF_HIST / 2; i++)
+      {
+         ProfHistT[i]   = ProfHistT[2 * i + 1];
+         ProfHistRpm[i] = ProfHistRpm[2 * i + 1];
+      }
+      ProfHistNum = PROF_HIST / 2;
+      ProfStride <<= 1;
+   }
+
+   ProfHistT[ProfHistNum]   = t;
+   ProfHistRpm[ProfHistNum] = rpm10;
+   ProfHistNum++;
+}
+
+/**
+ *  @fn ProfEdge
+ *  @brief The function processes a captured edge
+ *
+ *  @param stamp  timestamp of the edge
+ *  @return none
+ */
+static void ProfEdge(unsigned long stamp)
+{
+   unsigned char old;
+   unsigned long rpm10 = 0;
+   unsigned long dt;
+   long d;
+   long acc;
+
+   if(ProfCount++ == 0)
+      ProfFirst = stamp;
+
+   if(ProfNum >= NumMagnets)
+   {
+      old   = (ProfIdx - NumMagnets) & (MAX_MAGNETS - 1);
+      dt    = stamp - ProfStamp[old];
+      rpm10 = RpmTicksTenths(dt, NumMagnets);
+      ProfLast = rpm10;
+
+      if(rpm10 > ProfPeak)
+      {
+         ProfPeak  = rpm10;
+         ProfPeakT = stamp - ProfFirst;
+         ProfHist(ProfPeakT, rpm10);
+      }
+
+      /*
+       *  RPM/s = d(RPM x 10) * 32768 / (10 * dt), kept in 32 bit : multiplied
+       *  first, unless the speed change is too large for it (> 13107 RPM)
+       */
+      if(ProfRpm[old] && dt)
+      {
+         d = (long)rpm10 - (long)ProfRpm[old];
+         if(d < PROF_DMAX && d > -PROF_DMAX)
+            acc = d * 16384 / ((long)dt * 5);
+         else
+            acc = d / (long)dt * 16384 / 5;
+         if(acc > ProfAcc)
+            ProfAcc = acc;
+         if(acc < ProfDec)
+            ProfDec = acc;
+      }
+   }
+
+   ProfStamp[ProfIdx] = stamp;
+   ProfRpm[ProfIdx]   = rpm10;
+   ProfIdx = (ProfIdx + 1) & (MAX_MAGNETS - 1);
+   if(ProfNum < MAX_MAGNETS)
+      ProfNum++;
+}
+
+/**
+ *  @fn ProfT90
+ *  @brief The function gives the time to 90% of the peak speed
+ *
+ *  @param none
+ *  @return ticks from the first edge
+ */
+static unsigned long ProfT90(void)
+{
+   unsigned long limit = ProfPeak - ProfPeak / 10;
+   unsigned char i;
+
+   for(i = 0; i < ProfHistNum; i++)
+   {
+      if(ProfHistRpm[i] >= limit)
+         return ProfHistT[i];
+   }
+   return ProfPeakT;
+}
+
+/**
+ *  @fn ProfCsec
+ *  @brief The function converts Timer_A ticks in hundredths of second
+ *
+ *  @param ticks  Timer_A ticks (up to 80 minutes)
+ *  @return hundredths of second
+ */
+static unsigned long ProfCsec(unsigned long ticks)
+{
+   return (ticks * 25 + 4096) >> 13;
+}
+
+/**
+ *  @fn Profile
+ *  @brief The function records a speed profile until the joystick is pressed
+ *
+ *  @param none
+ *  @return none
+ */
+void Profile(void)
+{
+   /*
+    *  Max length
+    * "12345678901234"
+    */
+   unsigned long stamp;
+
+   ProfReset();
+
+   LCDClear();
+   LCDStr ( 0, (unsigned char *)" Profiling" );
+   LCDStr ( 1, (unsigned char *)" Edges:" );
+   LCDStr ( 2, (unsigned char *)" Lost :" );
+   LCDStr ( 3, (unsigned char *)" RPM =" );
+   LCDStr ( 4, (unsigned char *)" Peak=" );
+   LCDStr ( 5, (unsigned char *)" Press to stop" );
+   LCDUpdate();
+
+   RpmCaptureStart();
+
+   //until the joystick is pressed
+   while(KeyGet() != (KEY_ID_PUSH | KEY_EV_PRESS))
+   {
+      while(RpmCaptureGet(&stamp))
+         ProfEdge(stamp);
+
+      // Live figures, unless the last ones are still being sent
+      if(!LCDBusy())
+      {
+         LCDNum ( 7, 1, ProfCount, 7, 0 );
+         LCDNum ( 7, 2, Rpm_capLost, 7, 0 );
+         LCDNum ( 6, 3, ProfLast, 8, 1 );
+         LCDNum ( 6, 4, ProfPeak, 8, 1 );
+         LCDUpdate();
+      }
+
+      // Sleep until the ring is half full, the next bin or a key
+      SysSleep(MODE_LPM3);
+   }
+
+   RpmCaptureStop();
+   while(RpmCaptureGet(&stamp))
+      ProfEdge(stamp);
+
+   LCDClear();
+   LCDStr ( 0, (unsigned char *)" Profile done" );
+   LCDStr ( 1, (unsigned char *)" Peak=" );
+   LCDNum ( 6, 1, ProfPeak, 8, 1 );
+   LCDStr ( 2, (unsigned char *)" t pk s:" );
+   LCDNum ( 8, 2, ProfCsec(ProfPeakT), 6, 2 );
+   LCDStr ( 3, (unsigned char *)" t90 s:" );
+   LCDNum ( 7, 3, ProfCsec(ProfT90()), 7, 2 );
+   LCDStr ( 4, (unsigned char *)" Acc/s:" );
+   LCDNum ( 7, 4, ProfAcc, 7, 0 );
+   LCDStr ( 5, (unsigned char *)" Dec/s:" );
+   LCDNum ( 7, 5, -ProfDec, 7, 0 );
+   LCDUpdate();
+
+   while(KeyGet() != (KEY_ID_PUSH | KEY_EV_PRESS))
+      SysSleep(MODE_LPM3);
+}
+
+/*
+ *  This code is documented using DoxyGen
+ *  (http://www.stack.nl/~dimitri/doxygen/index.html)
+ */
@@ -0,0 +1,21 @@
+/**
+ *  @file profile.h
+ *  @author TheFwGuy
+ *  @version 1.0
+ *  @date October 2026
+ *  @brief Header file for the profile.c
+ */
+#ifndef __PROFILE_H
+#define __PROFILE_H
+
+/* definitions */
+
+#define PROF_HIST       32       /* Entries of the peak speed history */
+#define PROF_DMAX       131072L  /* Speed change (RPM x 10) for the 32 bit acceleration */
+
+/*
+ *  Function prototypes
+ */
+void Profile(void);
+
+#endif
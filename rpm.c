@@ -0,0 +1,1235 @@
+/**
+ *  @file rpm.c
+ *  @author TheFwGuy
+ *  @version 1.0
+ *  @date October 2026
+ *  @brief Hall sensor acquisition for the RPM meter
+ *
+ *  Three measurement modes are available :
+ *    MEAS_GATE    the Hall edges are counted by PORT1_ISR, and the count of
+ *                 the last AcqSecTime seconds is shown every RefreshBins bins
+ *    MEAS_PERIOD  every Hall edge is timestamped by the Timer_A capture unit
+ *                 and the RPM is computed from the time of the last revolution
+ *    MEAS_HWCOUNT the Hall sensor clocks Timer_B through TBCLK (P4.7), so the
+ *                 edges are counted by the hardware with no interrupt at all;
+ *                 the bin tick just reads the counter
+ *    MEAS_AUTO    the edges are timestamped as in the period mode, and the
+ *                 gate is the shortest whole number of revolutions lasting
+ *                 at least RPM_AUTO_TICKS : one sliding revolution at low
+ *                 speed, more revolutions (up to RPM_MAX_EDGES edges) as the
+ *                 edge rate grows. The resolution is always better than
+ *                 1 / RPM_AUTO_TICKS, with the shortest possible gate.
+ *
+ *  In the gate and period modes an optional glitch filter timestamps every
+ *  edge and rejects the ones closer than a minimum period to the previous
+ *  accepted edge : RPM_GLITCH_TICKS, or a quarter of the average edge period
+ *  in FILTER_AUTO. The rejected edges are counted in Rpm_reject.
+ *
+ *  A stopped rotor is detected without waiting for the gate: every accepted
+ *  edge moves a deadline RPM_STALL_MULT edge periods ahead (RPM_STALL_MAX at
+ *  most, or the window in the gate and hardware count modes, that read down
+ *  to one edge per window). If no edge arrives before it, a zero reading is published, the
+ *  acquisition restarts from scratch and Rpm_stall is set until the next
+ *  edge. The hardware count mode has no edge interrupt, there the bin tick
+ *  checks the bins with no edge against the edge rate of the window.
+ *
+ *  The speed trip output (TRIP_OUT) is driven by the edge interrupts : the
+ *  TripRpm threshold is converted once by RpmStart() in a revolution period
+ *  limit, so every edge only compares the last revolution with it, with no
+ *  division. The output is released RPM_TRIP_HYST past the limit. The
+ *  hardware count mode has no edge interrupt and no trip.
+ *
+ *  For the speed profiles the edge capture replaces the measure : PORT1_ISR
+ *  only stores the timestamp of every edge in a ring (16 bit TAR plus 8 bit
+ *  of the overflow count) and RpmCaptureGet() gives them back, extended to
+ *  32 bit, to the main loop.
+ *
+ *  The magnets are never evenly spaced, so in the period mode the interval
+ *  from one edge to the next follows the pattern of the spacing. The
+ *  calibration (RpmCalStart, RpmCalEnd) sums the intervals of every magnet
+ *  slot over CAL_REVS revolutions and stores the share of a revolution of
+ *  every slot in MagnetCal. With a table, after a restart every possible
+ *  alignment of the table is tried on one revolution (the full revolution
+ *  is published meanwhile), then every edge publishes its last interval
+ *  divided by the weight of its slot : a new reading at every edge, with
+ *  the spacing error of a full revolution.
+ *
+ *  Timer_A runs continuously on ACLK (32768 Hz). The overflow counter extends
+ *  it to a 32 bit time base, CCR0 captures the edges, CCR1 gives the 125 ms
+ *  bin tick and CCR2 the stall deadline.
+ *
+ *  In the counting modes the edges of every bin are kept in a ring, and the
+ *  window sum of the last AcqSecTime seconds slides one bin at a time. A long
+ *  window keeps the resolution of a long gate, while the display can be
+ *  refreshed up to every bin.
+ *
+ *  Every reading is published by the interrupt routines as one RpmSnap
+ *  record {count, gate, stamp} followed by an increment of the sequence
+ *  counter Rpm_seq. RpmRead() copies the record and checks the counter
+ *  again, so a reading published during the copy is never mixed with the
+ *  previous one, with no need to disable the interrupts.
+ */
+
+#include "system.h"
+#include "rpm.h"
+#include "keys.h"
+#include "hal.h"
+
+// Measurement variables
+extern unsigned char NumMagnets; /* Number of magnets */
+extern unsigned char AcqSecTime; /* Acquisition time in seconds */
+extern unsigned char MeasMode;   /* Measurement mode */
+extern unsigned char RefreshBins;/* Bins between two readings */
+extern unsigned char GlitchMode; /* Glitch filter */
+extern unsigned char TripMode;   /* Speed trip */
+extern unsigned short TripRpm;   /* Speed trip threshold */
+extern unsigned short MagnetCal[MAX_MAGNETS]; /* Magnet spacing weights */
+extern unsigned char CalMagnets; /* Magnets of the MagnetCal table */
+
+volatile RpmSnap       Rpm_snap;   /* Last reading */
+volatile unsigned char Rpm_seq;    /* Incremented after every new reading */
+
+unsigned short Rpm_cnt;          /* Hall edges in the current bin (interrupts only) */
+
+unsigned short Rpm_timeHi;       /* Upper half of the time base */
+unsigned char  Rpm_tick;         /* Bins elapsed in the current second */
+
+unsigned short Rpm_bin[MAX_BINS];      /* Edges counted in every bin */
+unsigned char  Rpm_binIdx;             /* Next position in Rpm_bin */
+unsigned char  Rpm_binNum;             /* Bins in the window (up to full) */
+unsigned char  Rpm_binRefresh;         /* Bins since the last reading */
+unsigned long  Rpm_winSum;             /* Edges counted in the window */
+
+unsigned long  Rpm_edge[MAX_MAGNETS];  /* Timestamps of the last edges */
+unsigned char  Rpm_edgeIdx;            /* Next position in Rpm_edge */
+unsigned char  Rpm_edgeNum;            /* Valid entries in Rpm_edge */
+
+unsigned long  Rpm_autoStart;          /* First edge of the auto mode gate */
+unsigned char  Rpm_autoEdges;          /* Edge intervals in the auto mode gate */
+unsigned char  Rpm_autoRev;            /* Edges in the current revolution */
+
+unsigned long  Rpm_lastEdge;     /* Timestamp of the last accepted edge */
+unsigned char  Rpm_lastValid;    /* Rpm_lastEdge is valid */
+unsigned short Rpm_edgeAvg;      /* Average edge period (FILTER_AUTO) */
+volatile unsigned short Rpm_reject; /* Edges rejected by the glitch filter */
+
+volatile unsigned char Rpm_stall; /* No edge before the deadline */
+unsigned long  Rpm_stallEdge;    /* Timestamp of the last edge (stall detection) */
+unsigned char  Rpm_stallValid;   /* Rpm_stallEdge is valid */
+unsigned long  Rpm_deadline;     /* Stall if no edge before this time */
+unsigned char  Rpm_idleBins;     /* Bins with no edge (hardware count mode) */
+unsigned long  Rpm_stallMax;     /* Longest stall timeout of the running measure */
+unsigned char  Rpm_stallBins;    /* The same in bins */
+
+volatile unsigned char Rpm_trip; /* Speed trip output state */
+unsigned char  Rpm_tripMode;     /* Trip mode of the running measure */
+unsigned long  Rpm_tripLimit;    /* Revolution period at the trip point */
+unsigned long  Rpm_tripRelease;  /* Revolution period at the release point */
+
+unsigned char  Rpm_capture;              /* Edge capture running */
+unsigned short Rpm_capLo[CAP_RING];      /* Edge timestamps, TAR */
+unsigned char  Rpm_capHi[CAP_RING];      /* Edge timestamps, overflow count */
+volatile unsigned char  Rpm_capHead;     /* Next entry to write (interrupt) */
+volatile unsigned char  Rpm_capTail;     /* Next entry to read (main loop) */
+volatile unsigned short Rpm_capLost;     /* Edges lost with the ring full */
+unsigned long  Rpm_capLast;              /* Last timestamp read */
+
+unsigned char  Rpm_slot;         /* Magnet slot of the next edge interval */
+unsigned char  Rpm_calLearn;     /* Calibration running */
+unsigned long  Rpm_calSum[MAX_MAGNETS];  /* Intervals of every slot (calibration) */
+volatile unsigned char Rpm_calRevs; /* Revolutions summed (calibration) */
+unsigned short Rpm_calInv[MAX_MAGNETS];  /* Inverse of the slot weights (Q15) */
+unsigned char  Rpm_calTry;       /* Table alignment tried next, CAL_OFF if no table */
+unsigned char  Rpm_calPhase;     /* Best table alignment */
+unsigned long  Rpm_calCost;      /* Mismatch of the best alignment */
+
+unsigned short Rpm_hwHi;         /* Timer_B overflow count (hardware count mode) */
+unsigned long  Rpm_hwLast;       /* Hardware count at the previous bin */
+
+static unsigned long RpmHwCount(void);
+static unsigned long RpmNow(void);
+static void RpmArm(unsigned long deadline);
+static void RpmTripOut(unsigned char on);
+
+/*
+ *  Gate scale factors, RPM x 10 = count * 600 / (magnets * seconds)
+ *
+ *  Every factor is stored as a 16 bit mantissa and a right shift, with the
+ *  largest shift that keeps the rounded mantissa in 16 bit. The table is
+ *  computed by the compiler for all the NumMagnets and AcqSecTime values.
+ */
+typedef struct
+{
+   unsigned short mant;
+   unsigned char  shift;
+} RpmScale;
+
+#define SCALE_M(q, s)   (((600UL << (s)) + (q) / 2) / (q))
+#define SCALE_S(q)      (SCALE_M(q, 16) < 0x10000UL ? 16 : \
+                         SCALE_M(q, 15) < 0x10000UL ? 15 : \
+                         SCALE_M(q, 14) < 0x10000UL ? 14 : \
+                         SCALE_M(q, 13) < 0x10000UL ? 13 : \
+                         SCALE_M(q, 12) < 0x10000UL ? 12 : \
+                         SCALE_M(q, 11) < 0x10000UL ? 11 : \
+                         SCALE_M(q, 10) < 0x10000UL ? 10 : \
+                         SCALE_M(q, 9)  < 0x10000UL ? 9  : \
+                         SCALE_M(q, 8)  < 0x10000UL ? 8  : \
+                         SCALE_M(q, 7)  < 0x10000UL ? 7  : 6)
+#define SCALE(q)        { SCALE_M(q, SCALE_S(q)), SCALE_S(q) }
+#define SCALE_ROW(m)    { SCALE((m) * 1), SCALE((m) * 2), SCALE((m) * 3), \
+                          SCALE((m) * 4), SCALE((m) * 5), SCALE((m) * 6), \
+                          SCALE((m) * 7), SCALE((m) * 8), SCALE((m) * 9), \
+                          SCALE((m) * 10) }
+
+static const RpmScale RpmScaleTab[MAX_MAGNETS][MAX_ACQ_TIME] =
+{
+   SCALE_ROW(1), SCALE_ROW(2), SCALE_ROW(3), SCALE_ROW(4),
+   SCALE_ROW(5), SCALE_ROW(6), SCALE_ROW(7), SCALE_ROW(8)
+};
+
+/**
+ *  @fn RpmStart
+ *  @brief The function resets the acquisition before a new measure
+ *
+ *  @param none
+ *  @return none
+ */
+void RpmStart(void)
+{
+   unsigned char mode = TripMode;
+   unsigned long limit = 0;
+   unsigned long release = 0;
+   unsigned char cal = CAL_OFF;
+   unsigned long stallMax = RPM_STALL_MAX;
+   unsigned char k;
+
+   /* Trip limits as revolution periods, the interrupts only compare */
+   if(TripRpm == 0 || MeasMode == MEAS_HWCOUNT)
+      mode = TRIP_OFF;
+   if(mode != TRIP_OFF)
+   {
+      limit = RPM_TICKS_REV / TripRpm;
+      if(mode == TRIP_OVER)
+         release = limit + (limit >> RPM_TRIP_HYST);
+      else
+         release = limit - (limit >> RPM_TRIP_HYST);
+   }
+
+   /* The gate modes read one edge per window, do not stall before it ends */
+   if((MeasMode == MEAS_GATE || MeasMode == MEAS_HWCOUNT) &&
+      ((unsigned long)AcqSecTime << 15) > stallMax)
+      stallMax = (unsigned long)AcqSecTime << 15;
+
+   /* Slot corrections as multipliers, the interrupts do not divide */
+   if(MeasMode == MEAS_PERIOD && NumMagnets > 1 && CalMagnets == NumMagnets)
+   {
+      cal = 0;
+      for(k = 0; k < NumMagnets; k++)
+         Rpm_calInv[k] = (0x40000000UL + MagnetCal[k] / 2) / MagnetCal[k];
+   }
+
+   dint();
+   Rpm_tripMode    = mode;
+   Rpm_tripLimit   = limit;
+   Rpm_tripRelease = release;
+   RpmTripOut(mode == TRIP_UNDER);      /* Underspeed until shown otherwise */
+   Rpm_cnt         = 0;
+   Rpm_binIdx      = 0;
+   Rpm_binNum      = 0;
+   Rpm_binRefresh  = RefreshBins - 1;   /* first reading when the window is full */
+   Rpm_winSum      = 0;
+   Rpm_edgeIdx     = 0;
+   Rpm_edgeNum     = 0;
+   Rpm_autoEdges   = 0;
+   Rpm_autoRev     = 0;
+   Rpm_slot        = 0;
+   Rpm_calTry      = cal;
+   Rpm_calLearn    = 0;
+   Rpm_lastValid   = 0;
+   Rpm_edgeAvg     = 0;
+   Rpm_reject      = 0;
+   Rpm_stall       = 0;
+   Rpm_idleBins    = 0;
+   Rpm_stallMax    = stallMax;
+   Rpm_stallBins   = (unsigned char)(stallMax / TMRVALUE);
+   Rpm_stallValid  = 0;
+   Rpm_stallEdge   = RpmNow();
+   Rpm_hwLast      = RpmHwCount();
+   TACCR1          = (unsigned short)Rpm_stallEdge + TMRVALUE;  /* no partial first bin */
+   TACCTL1        &= ~CCIFG;
+   if(MeasMode == MEAS_HWCOUNT)
+      TACCTL2 = 0;
+   else
+      RpmArm(Rpm_stallEdge + Rpm_stallMax);
+   eint();
+}
+
+/**
+ *  @fn RpmGateTenths
+ *  @brief The function converts a gate count in RPM
+ *
+ *  RPM x 10 = count * 600 / (NumMagnets * AcqSecTime), done with one
+ *  16 x 16 multiplication on the hardware multiplier and a shift. Counts
+ *  above 16 bit are rounded to 16 bit first. The result is within 0.5 +
+ *  1/32768 of the exact value.
+ *  Not to be called from an interrupt routine.
+ *
+ *  @param count  Hall edges counted in AcqSecTime seconds
+ *  @return RPM x 10
+ */
+unsigned long RpmGateTenths(unsigned long count)
+{
+   const RpmScale *k = &RpmScaleTab[NumMagnets - 1][AcqSecTime - 1];
+   unsigned char shift = k->shift;
+   unsigned char pre = 0;
+   unsigned short sr;
+   unsigned long res;
+
+   while((count >> pre) > 0xFFFFUL)
+      pre++;
+   if(pre)
+   {
+      count = (count >> pre) + ((count >> (pre - 1)) & 1);
+      if(count > 0xFFFFUL)
+      {
+         count >>= 1;
+         pre++;
+      }
+   }
+
+   /* The multiplier is shared with the compiler generated code */
+   sr = READ_SR;
+   dint();
+   MPY = (unsigned short)count;
+   OP2 = k->mant;
+   res = ((unsigned long)RESHI << 16) | RESLO;
+   if(sr & GIE)
+      eint();
+
+   if(pre > shift)
+   {
+      pre -= shift;
+      if(res > (0xFFFFFFFFUL >> pre))
+         return 0xFFFFFFFFUL;
+      return res << pre;
+   }
+
+   shift -= pre;
+   if(shift == 0)
+      return res;
+   return (res + (1UL << (shift - 1))) >> shift;
+}
+
+/**
+ *  @fn RpmTicksTenths
+ *  @brief The function converts a measured period in RPM
+ *
+ *  @param period  Timer_A ticks spanned by the edges
+ *  @param edges   number of edge intervals in the period
+ *  @return RPM x 10
+ */
+unsigned long RpmTicksTenths(unsigned long period, unsigned char edges)
+{
+   /* Beyond 2^28 ticks (more than two hours) the motor is stopped */
+   if(edges == 0 || period == 0 || period >= 0x10000000UL)
+      return 0;
+
+   period *= NumMagnets;
+   return (RPM10_TICKS * edges + period / 2) / period;
+}
+
+/**
+ *  @fn RpmTenths
+ *  @brief The function converts a reading in RPM for the measurement mode
+ *
+ *  Not to be called from an interrupt routine.
+ *
+ *  @param snap  reading
+ *  @return RPM x 10
+ */
+unsigned long RpmTenths(const RpmSnap *snap)
+{
+   if(MeasMode == MEAS_PERIOD || MeasMode == MEAS_AUTO)
+      return RpmTicksTenths(snap->gate, (unsigned char)snap->count);
+   return RpmGateTenths(snap->count);
+}
+
+/**
+ *  @fn RpmRead
+ *  @brief The function copies the last reading published by the interrupts
+ *
+ *  The copy is repeated if a new reading is published meanwhile.
+ *
+ *  @param snap  returns the reading
+ *  @param seq   sequence number of the last reading seen, updated
+ *  @return 1 if the reading is new
+ */
+unsigned char RpmRead(RpmSnap *snap, unsigned char *seq)
+{
+   unsigned char now;
+
+   do
+   {
+      now          = Rpm_seq;
+      snap->count  = Rpm_snap.count;
+      snap->gate   = Rpm_snap.gate;
+      snap->stamp  = Rpm_snap.stamp;
+   } while(now != Rpm_seq);
+
+   if(now == *seq)
+      return 0;
+
+   *seq = now;
+   return 1;
+}
+
+/**
+ *  @fn RpmPublish
+ *  @brief The function publishes a new reading (interrupt routines only)
+ *
+ *  The calling routine wakes the main loop with SYS_WAKE_POSTED.
+ *
+ *  @param count  edges or edge intervals
+ *  @param gate   Timer_A ticks covered by count
+ *  @param stamp  time base at the end of the gate
+ *  @return none
+ */
+static void RpmPublish(unsigned long count, unsigned long gate, unsigned long stamp)
+{
+   Rpm_snap.count = count;
+   Rpm_snap.gate  = gate;
+   Rpm_snap.stamp = stamp;
+   Rpm_seq++;
+   SYS_POST();
+}
+
+/**
+ *  @fn RpmCaptureStart
+ *  @brief The function starts the edge capture on P1.1
+ *
+ *  The measure stops : P1.1 gives a port interrupt whatever the mode, and
+ *  the capture, stall and bin processing are off until RpmCaptureStop()
+ *  and InitTimer().
+ *
+ *  @param none
+ *  @return none
+ */
+void RpmCaptureStart(void)
+{
+   dint();
+   TACCTL0      = 0;
+   TACCTL2      = 0;
+   Rpm_capHead  = 0;
+   Rpm_capTail  = 0;
+   Rpm_capLost  = 0;
+   Rpm_capLast  = RpmNow();
+   Rpm_capture  = 1;
+
+   P1SEL &= ~RPM_IN;                  /* P1.1 is I/O */
+   P1IES &= ~RPM_IN;                  /* Rising edges */
+   P1IFG &= ~RPM_IN;
+   P1IE  |= RPM_IN;
+   eint();
+}
+
+/**
+ *  @fn RpmCaptureStop
+ *  @brief The function stops the edge capture
+ *
+ *  InitTimer() then sets the input back for the measurement mode.
+ *
+ *  @param none
+ *  @return none
+ */
+void RpmCaptureStop(void)
+{
+   dint();
+   Rpm_capture = 0;
+   P1IE &= ~RPM_IN;
+   eint();
+}
+
+/**
+ *  @fn RpmCaptureGet
+ *  @brief The function reads the oldest captured edge
+ *
+ *  The 24 bit timestamps are extended with the previous one, so two edges
+ *  must not be more than 8 minutes apart.
+ *
+ *  @param stamp  returns the timestamp
+ *  @return 1 if an edge was available
+ */
+unsigned char RpmCaptureGet(unsigned long *stamp)
+{
+   unsigned char tail = Rpm_capTail;
+   unsigned long t;
+
+   if(tail == Rpm_capHead)
+      return 0;
+
+   t = ((unsigned long)Rpm_capHi[tail] << 16) | Rpm_capLo[tail];
+   Rpm_capTail = (tail + 1) & (CAP_RING - 1);
+
+   t |= Rpm_capLast & 0xFF000000UL;
+   if(t < Rpm_capLast)
+      t += 0x1000000UL;
+
+   Rpm_capLast = t;
+   *stamp = t;
+   return 1;
+}
+
+/**
+ *  @fn RpmCalClear
+ *  @brief The function clears the calibration sums
+ *
+ *  @param none
+ *  @return none
+ */
+static void RpmCalClear(void)
+{
+   unsigned char k;
+
+   for(k = 0; k < MAX_MAGNETS; k++)
+      Rpm_calSum[k] = 0;
+   Rpm_calRevs = 0;
+}
+
+/**
+ *  @fn RpmCalStart
+ *  @brief The function starts the magnet spacing calibration
+ *
+ *  To be called after RpmStart() in the period mode, with the rotor at a
+ *  steady speed. Rpm_calRevs counts the revolutions summed up to CAL_REVS.
+ *
+ *  @param none
+ *  @return none
+ */
+void RpmCalStart(void)
+{
+   dint();
+   RpmCalClear();
+   Rpm_calLearn = 1;
+   eint();
+}
+
+/**
+ *  @fn RpmCalEnd
+ *  @brief The function stops the calibration and stores the table
+ *
+ *  The weight of a slot is its share of the revolution times NumMagnets,
+ *  CAL_ONE for an evenly spaced magnet. The table is kept only after
+ *  CAL_REVS revolutions and with every weight within CAL_MIN and CAL_MAX,
+ *  otherwise (a lost edge, a stop) MagnetCal is left as it was.
+ *
+ *  @param none
+ *  @return 1 if the table is stored
+ */
+unsigned char RpmCalEnd(void)
+{
+   unsigned short tab[MAX_MAGNETS];
+   unsigned long total = 0;
+   unsigned long w;
+   unsigned char shift = 0;
+   unsigned char k;
+
+   Rpm_calLearn = 0;
+   if(Rpm_calRevs < CAL_REVS)
+      return 0;
+
+   for(k = 0; k < NumMagnets; k++)
+      total += Rpm_calSum[k];
+
+   /* Sums scaled to 16 bit, so that sum * NumMagnets << 15 fits in 32 bit */
+   while((total >> shift) > 0xFFFFUL)
+      shift++;
+   total >>= shift;
+   if(total == 0)
+      return 0;
+
+   for(k = 0; k < NumMagnets; k++)
+   {
+      w = (((Rpm_calSum[k] >> shift) * NumMagnets << 15) + total / 2) / total;
+      if(w <= CAL_MIN || w >= CAL_MAX)
+         return 0;
+      tab[k] = (unsigned short)w;
+   }
+
+   for(k = 0; k < NumMagnets; k++)
+      MagnetCal[k] = tab[k];
+   CalMagnets = NumMagnets;
+   return 1;
+}
+
+/**
+ *  @fn RpmCalSum
+ *  @brief The function adds the last edge interval to the calibration
+ *
+ *  Called on every accepted edge of the period mode, before the edge
+ *  enters the ring.
+ *
+ *  @param stamp  timestamp of the edge
+ *  @return none
+ */
+static void RpmCalSum(unsigned long stamp)
+{
+   if(Rpm_edgeNum == 0 || Rpm_calRevs >= CAL_REVS)
+      return;
+
+   Rpm_calSum[Rpm_slot] += stamp - Rpm_edge[(Rpm_edgeIdx - 1) & (MAX_MAGNETS - 1)];
+
+   /* Slot 0 closes a revolution, every slot has one more interval */
+   if(Rpm_slot == 0)
+      Rpm_calRevs++;
+}
+
+/**
+ *  @fn RpmCalCost
+ *  @brief The function compares the last revolution with an alignment of
+ *         the table
+ *
+ *  The intervals and the revolution are scaled below 2^15 ticks, so every
+ *  interval * NumMagnets << 12 is compared with revolution * weight in
+ *  32 bit.
+ *
+ *  @param stamp  timestamp of the edge closing the revolution
+ *  @param phase  table slot of the slot 0 intervals
+ *  @return mismatch, the lower the better
+ */
+static unsigned long RpmCalCost(unsigned long stamp, unsigned char phase)
+{
+   unsigned long rev = stamp - Rpm_edge[(Rpm_edgeIdx - NumMagnets) & (MAX_MAGNETS - 1)];
+   unsigned long cost = 0;
+   unsigned long prev = stamp;
+   unsigned long t, a, b;
+   unsigned char shift = 0;
+   unsigned char slot = Rpm_slot;
+   unsigned char m, k;
+
+   while((rev >> shift) >= 0x8000UL)
+      shift++;
+   rev >>= shift;
+
+   for(m = 1; m <= NumMagnets; m++)
+   {
+      t    = Rpm_edge[(Rpm_edgeIdx - m) & (MAX_MAGNETS - 1)];
+      a    = ((prev - t) >> shift) * NumMagnets << 12;
+      prev = t;
+
+      k = slot + phase;
+      if(k >= NumMagnets)
+         k -= NumMagnets;
+      b = rev * (MagnetCal[k] >> 3);
+
+      cost += (a > b ? a - b : b - a) >> 3;
+      slot = slot ? slot - 1 : NumMagnets - 1;
+   }
+   return cost;
+}
+
+/**
+ *  @fn RpmCalEdge
+ *  @brief The function publishes the reading of an edge with the table
+ *
+ *  Called on every accepted edge of the period mode once a revolution is
+ *  in the ring. Until every alignment of the table has been tried the
+ *  full revolution is published, then the last interval corrected by the
+ *  weight of its slot.
+ *
+ *  @param stamp  timestamp of the edge
+ *  @return none
+ */
+static void RpmCalEdge(unsigned long stamp)
+{
+   unsigned long dt;
+   unsigned long cost;
+   unsigned short inv;
+   unsigned char k;
+
+   if(Rpm_calTry < NumMagnets)
+   {
+      cost = RpmCalCost(stamp, Rpm_calTry);
+      if(Rpm_calTry == 0 || cost < Rpm_calCost)
+      {
+         Rpm_calCost  = cost;
+         Rpm_calPhase = Rpm_calTry;
+      }
+      Rpm_calTry++;
+
+      RpmPublish(NumMagnets,
+                 stamp - Rpm_edge[(Rpm_edgeIdx - NumMagnets) & (MAX_MAGNETS - 1)],
+                 stamp);
+      return;
+   }
+
+   k = Rpm_slot + Rpm_calPhase;
+   if(k >= NumMagnets)
+      k -= NumMagnets;
+   inv = Rpm_calInv[k];
+
+   /* dt * inv >> 15 in two halves, dt is below the stall timeout (2^17) */
+   dt = stamp - Rpm_edge[(Rpm_edgeIdx - 1) & (MAX_MAGNETS - 1)];
+   dt = ((dt >> 16) * inv << 1) + (((dt & 0xFFFFUL) * inv + 0x4000UL) >> 15);
+
+   RpmPublish(1, dt, stamp);
+}
+
+/**
+ *  @fn RpmStamp
+ *  @brief The function extends a 16 bit Timer_A value to the 32 bit time base
+ *
+ *  If the overflow is still pending (the Timer_A1 interrupt did not run yet)
+ *  a low value belongs to the next period.
+ *
+ *  @param lo  Timer_A value
+ *  @return timestamp
+ */
+static unsigned long RpmStamp(unsigned short lo)
+{
+   unsigned short hi = Rpm_timeHi;
+
+   if((TACTL & TAIFG) && lo < 0x8000)
+      hi++;
+
+   return ((unsigned long)hi << 16) | lo;
+}
+
+/**
+ *  @fn RpmNow
+ *  @brief The function reads the 32 bit time base
+ *
+ *  TAR runs on ACLK, asynchronous to MCLK, so it is read until two
+ *  consecutive values agree.
+ *
+ *  @param none
+ *  @return timestamp
+ */
+static unsigned long RpmNow(void)
+{
+   unsigned short lo;
+
+   do
+   {
+      lo = TAR;
+   } while(lo != TAR);
+
+   return RpmStamp(lo);
+}
+
+/**
+ *  @fn RpmTime
+ *  @brief The function reads the 32 bit time base, for the other modules
+ *
+ *  @param none
+ *  @return timestamp (Timer_A ticks)
+ */
+unsigned long RpmTime(void)
+{
+   return RpmNow();
+}
+
+/**
+ *  @fn RpmGlitch
+ *  @brief The function checks an edge against the glitch filter
+ *
+ *  @param stamp  timestamp of the edge
+ *  @return 1 if the edge is rejected
+ */
+static unsigned char RpmGlitch(unsigned long stamp)
+{
+   unsigned long dt = stamp - Rpm_lastEdge;
+   unsigned short min = RPM_GLITCH_TICKS;
+
+   if(Rpm_lastValid)
+   {
+      if(GlitchMode == FILTER_AUTO && (Rpm_edgeAvg >> 2) > min)
+         min = Rpm_edgeAvg >> 2;
+
+      if(dt < min)
+      {
+         Rpm_reject++;
+         return 1;
+      }
+
+      /* Running average over 8 edges */
+      if(dt > 0xFFFFUL)
+         dt = 0xFFFFUL;
+      if(Rpm_edgeAvg)
+         Rpm_edgeAvg = Rpm_edgeAvg - (Rpm_edgeAvg >> 3) + ((unsigned short)dt >> 3);
+      else
+         Rpm_edgeAvg = (unsigned short)dt;
+   }
+
+   Rpm_lastEdge  = stamp;
+   Rpm_lastValid = 1;
+   return 0;
+}
+
+/**
+ *  @fn RpmArm
+ *  @brief The function sets the stall deadline on TACCR2
+ *
+ *  A deadline further than half the Timer_A period is reached in steps of
+ *  0x8000 ticks, the Timer_A1 routine re-arms CCR2 until it is due.
+ *
+ *  @param deadline  time of the stall if no edge arrives
+ *  @return none
+ */
+static void RpmArm(unsigned long deadline)
+{
+   unsigned long now = RpmNow();
+   long rem = (long)(deadline - now);
+
+   Rpm_deadline = deadline;
+   if(rem < 2)
+      rem = 2;
+   else if(rem > 0x8000L)
+      rem = 0x8000L;
+
+   TACCR2  = (unsigned short)(now + rem);
+   TACCTL2 = CCIE;                    /* Compare mode, clears a pending CCIFG */
+}
+
+/**
+ *  @fn RpmAlive
+ *  @brief The function moves the stall deadline after an accepted edge
+ *
+ *  @param stamp  timestamp of the edge
+ *  @return none
+ */
+static void RpmAlive(unsigned long stamp)
+{
+   unsigned long timeout = Rpm_stallMax;
+   unsigned long dt;
+
+   if(Rpm_stallValid)
+   {
+      dt = stamp - Rpm_stallEdge;
+      if(dt < Rpm_stallMax / RPM_STALL_MULT)
+         timeout = dt * RPM_STALL_MULT;
+      if(timeout < RPM_STALL_MIN)
+         timeout = RPM_STALL_MIN;
+   }
+
+   Rpm_stallEdge  = stamp;
+   Rpm_stallValid = 1;
+   Rpm_stall      = 0;
+   RpmArm(stamp + timeout);
+}
+
+/**
+ *  @fn RpmTripOut
+ *  @brief The function drives the speed trip output
+ *
+ *  @param on  1 to trip
+ *  @return none
+ */
+static void RpmTripOut(unsigned char on)
+{
+   if(on)
+      P2OUT |= TRIP_OUT;
+   else
+      P2OUT &= ~TRIP_OUT;
+   Rpm_trip = on;
+}
+
+/**
+ *  @fn RpmTrip
+ *  @brief The function checks the last revolution against the trip limits
+ *
+ *  Called on every accepted edge, before the edge enters the ring.
+ *
+ *  @param stamp  timestamp of the edge
+ *  @return none
+ */
+static void RpmTrip(unsigned long stamp)
+{
+   unsigned long rev;
+   unsigned char on;
+
+   if(Rpm_tripMode == TRIP_OFF || Rpm_edgeNum < NumMagnets)
+      return;
+
+   rev = stamp - Rpm_edge[(Rpm_edgeIdx - NumMagnets) & (MAX_MAGNETS - 1)];
+   if(Rpm_tripMode == TRIP_OVER)
+      on = rev < (Rpm_trip ? Rpm_tripRelease : Rpm_tripLimit);
+   else
+      on = rev > (Rpm_trip ? Rpm_tripRelease : Rpm_tripLimit);
+
+   if(on != Rpm_trip)
+      RpmTripOut(on);
+}
+
+/**
+ *  @fn RpmRing
+ *  @brief The function adds an accepted edge to the edge ring
+ *
+ *  @param stamp  timestamp of the edge
+ *  @return none
+ */
+static void RpmRing(unsigned long stamp)
+{
+   Rpm_edge[Rpm_edgeIdx] = stamp;
+   Rpm_edgeIdx = (Rpm_edgeIdx + 1) & (MAX_MAGNETS - 1);
+   if(Rpm_edgeNum < MAX_MAGNETS)
+      Rpm_edgeNum++;
+   if(++Rpm_slot >= NumMagnets)
+      Rpm_slot = 0;
+}
+
+/**
+ *  @fn RpmStall
+ *  @brief The function reports a stopped rotor
+ *
+ *  A zero reading is published and the acquisition restarts, so the
+ *  readings before the stop are not mixed with the ones after it.
+ *
+ *  @param since  Timer_A ticks since the last edge
+ *  @return none
+ */
+static void RpmStall(unsigned long since)
+{
+   TACCTL2 = 0;
+
+   Rpm_stall       = 1;
+   Rpm_stallValid  = 0;
+   Rpm_lastValid   = 0;
+   Rpm_edgeAvg     = 0;
+   Rpm_edgeNum     = 0;
+   Rpm_autoEdges   = 0;
+   Rpm_autoRev     = 0;
+   Rpm_slot        = 0;
+   Rpm_binNum      = 0;
+   Rpm_winSum      = 0;
+   Rpm_binRefresh  = RefreshBins - 1;
+   Rpm_idleBins    = 0;
+
+   /* The slots are numbered again from the next edge */
+   if(Rpm_calTry != CAL_OFF)
+      Rpm_calTry = 0;
+   if(Rpm_calLearn)
+      RpmCalClear();
+
+   if(Rpm_tripMode != TRIP_OFF)
+      RpmTripOut(Rpm_tripMode == TRIP_UNDER);
+
+   RpmPublish(0, since, RpmNow());
+}
+
+/**
+ *  @fn RpmAuto
+ *  @brief The function sizes the auto mode gate on every accepted edge
+ *
+ *  If the last revolution lasted at least RPM_AUTO_TICKS it is published,
+ *  as in the period mode. Otherwise the gate grows by whole revolutions
+ *  from the last published edge until it is long enough.
+ *
+ *  @param stamp  timestamp of the edge
+ *  @param span   edge intervals available in the edge ring (up to NumMagnets)
+ *  @return none
+ */
+static void RpmAuto(unsigned long stamp, unsigned char span)
+{
+   unsigned long ticks;
+
+   if(span == NumMagnets)
+   {
+      ticks = stamp - Rpm_edge[(Rpm_edgeIdx - span) & (MAX_MAGNETS - 1)];
+      if(ticks >= RPM_AUTO_TICKS)
+      {
+         RpmPublish(span, ticks, stamp);
+         Rpm_autoStart = stamp;
+         Rpm_autoEdges = 0;
+         Rpm_autoRev   = 0;
+         return;
+      }
+   }
+
+   if(span == 0)
+   {
+      Rpm_autoStart = stamp;
+      return;
+   }
+
+   Rpm_autoEdges++;
+   if(++Rpm_autoRev < NumMagnets)
+      return;
+   Rpm_autoRev = 0;
+
+   ticks = stamp - Rpm_autoStart;
+   if(ticks >= RPM_AUTO_TICKS || Rpm_autoEdges + NumMagnets > RPM_MAX_EDGES)
+   {
+      RpmPublish(Rpm_autoEdges, ticks, stamp);
+      Rpm_autoStart = stamp;
+      Rpm_autoEdges = 0;
+   }
+}
+
+/**
+ *  @fn RpmHwCount
+ *  @brief The function reads the Hall edges counted by Timer_B
+ *
+ *  TBR is clocked asynchronously by the Hall sensor, so it is read until two
+ *  consecutive values agree. The counter is never stopped or cleared: the
+ *  gate works on the difference, so no edge is lost while reading it.
+ *
+ *  @param none
+ *  @return edges counted since the Timer_B start (32 bit)
+ */
+static unsigned long RpmHwCount(void)
+{
+   unsigned short lo;
+   unsigned short hi;
+
+   do
+   {
+      lo = TBR;
+   } while(lo != TBR);
+
+   hi = Rpm_hwHi;
+   if((TBCTL & TBIFG) && lo < 0x8000)
+      hi++;
+
+   return ((unsigned long)hi << 16) | lo;
+}
+
+/**
+ * Timer_A
+ * @brief Timer A0 interrupt service routine
+ *
+ * This function handle the CCR0 capture of a Hall sensor edge (period and
+ * auto modes). In period mode the new timestamp is compared with the one of
+ * a revolution ago, or with the oldest available until a full revolution has
+ * been seen. With a spacing calibration table the interval from the previous
+ * edge is published instead, corrected by the weight of its slot.
+ *
+ * @param none
+ * @return None
+ */
+interrupt(TIMERA0_VECTOR) Timer_A (void)
+{
+   unsigned long stamp;
+   unsigned char span;
+
+   stamp = RpmStamp(TACCR0);
+   if(GlitchMode != FILTER_OFF && RpmGlitch(stamp))
+      return;
+
+   P2OUT ^= BIT1;   // toggle status LED
+   RpmAlive(stamp);
+   RpmTrip(stamp);
+
+   if(Rpm_calLearn)
+      RpmCalSum(stamp);
+
+   span = (Rpm_edgeNum < NumMagnets) ? Rpm_edgeNum : NumMagnets;
+   if(MeasMode == MEAS_AUTO)
+      RpmAuto(stamp, span);
+   else if(span == NumMagnets && Rpm_calTry != CAL_OFF)
+      RpmCalEdge(stamp);
+   else if(span)
+   {
+      RpmPublish(span, stamp - Rpm_edge[(Rpm_edgeIdx - span) & (MAX_MAGNETS - 1)],
+                 stamp);
+   }
+
+   RpmRing(stamp);
+   SYS_WAKE_POSTED();
+}
+
+/**
+ * Timer_A1
+ * @brief Timer A1 interrupt service routine
+ *
+ * This function handle the CCR1 bin tick, the CCR2 stall deadline and the
+ * Timer_A overflow.
+ *
+ * In the counting modes the edges of the bin are added to the window and the
+ * oldest bin leaves it. Once the window is full, every RefreshBins bins the
+ * window sum is published as a new reading.
+ *
+ * @param none
+ * @return None
+ */
+interrupt(TIMERA1_VECTOR) Timer_A1 (void)
+{
+   unsigned long count;
+   unsigned long stamp;
+   unsigned short edges;
+   unsigned char window;
+   unsigned char old;
+
+   switch(TAIV)
+   {
+      case 2:     /* TACCR1 - bin tick */
+         stamp   = RpmStamp(TACCR1);
+         TACCR1 += TMRVALUE;
+         if(++Rpm_tick >= BINS_PER_SEC)
+         {
+            Rpm_tick = 0;
+            P2OUT ^= BIT2;   // toggle status clock
+         }
+
+         /* Edge capture: the main loop empties the ring at least every bin */
+         if(Rpm_capture)
+         {
+            SYS_WAKE();
+            break;
+         }
+
+         if(MeasMode == MEAS_PERIOD || MeasMode == MEAS_AUTO)
+            break;
+
+         if(MeasMode == MEAS_HWCOUNT)
+         {
+            count      = RpmHwCount();
+            edges      = (unsigned short)(count - Rpm_hwLast);
+            Rpm_hwLast = count;
+         }
+         else
+         {
+            edges   = Rpm_cnt;
+            Rpm_cnt = 0;
+         }
+
+         window = AcqSecTime * BINS_PER_SEC;
+         if(Rpm_binNum >= window)
+         {
+            old = (Rpm_binIdx >= window) ? Rpm_binIdx - window
+                                         : Rpm_binIdx + MAX_BINS - window;
+            Rpm_winSum -= Rpm_bin[old];
+         }
+         else
+            Rpm_binNum++;
+
+         /* Stall: no edge for RPM_STALL_MULT edge periods of the window */
+         if(MeasMode == MEAS_HWCOUNT)
+         {
+            if(edges)
+            {
+               Rpm_idleBins = 0;
+               Rpm_stall    = 0;
+            }
+            else if(!Rpm_stall)
+            {
+               Rpm_idleBins++;
+               if((Rpm_winSum && Rpm_idleBins * Rpm_winSum >= RPM_STALL_MULT * Rpm_binNum) ||
+                  Rpm_idleBins >= Rpm_stallBins)
+               {
+                  RpmStall((unsigned long)Rpm_idleBins * TMRVALUE);
+                  break;
+               }
+            }
+         }
+
+         Rpm_bin[Rpm_binIdx] = edges;
+         Rpm_winSum += edges;
+         if(++Rpm_binIdx >= MAX_BINS)
+            Rpm_binIdx = 0;
+
+         if(Rpm_binNum >= window && ++Rpm_binRefresh >= RefreshBins)
+         {
+            Rpm_binRefresh = 0;
+            RpmPublish(Rpm_winSum, (unsigned long)window * TMRVALUE, stamp);
+         }
+         break;
+
+      case 4:     /* TACCR2 - stall deadline */
+         count = RpmNow();
+         if((long)(Rpm_deadline - count) > 0)
+            RpmArm(Rpm_deadline);
+         else
+            RpmStall(Rpm_stallValid ? count - Rpm_stallEdge : Rpm_stallMax);
+         break;
+
+      case 10:    /* TAIFG - overflow */
+         Rpm_timeHi++;
+         break;
+
+      default:
+         break;
+   }
+
+   SYS_WAKE_POSTED();
+}
+
+/**
+ * Timer_B1
+ * @brief Timer B1 interrupt service routine
+ *
+ * This function handle the Timer_B overflow, once every 65536 Hall edges
+ * in hardware count mode.
+ *
+ * @param none
+ * @return None
+ */
+interrupt(TIMERB1_VECTOR) Timer_B1 (void)
+{
+   if(TBIV == 14)    /* TBIFG - overflow */
+      Rpm_hwHi++;
+}
+
+/**
+ * I/O Port 1
+ * @brief I/O port 1 interrupt service routine
+ *
+ * This function handle the I/O Port 1 interrupt : the Hall sensor edges
+ * (gate mode) and the joystick.
+ *
+ * @param none
+ * @return None
+ */
+interrupt(PORT1_VECTOR) PORT1_ISR(void)
+{
+   unsigned long stamp;
+   unsigned char next;
+
+   if(P1IFG & RPM_IN)
+   {
+      /*
+       *  Interrupt on Pin 1.1 !
+       *  Be sure is not a spike !
+       */
+      if((P1IN & RPM_IN) && Rpm_capture)
+      {
+         /* Edge capture: store the timestamp, wake the main loop at half ring */
+         stamp = RpmNow();
+         next  = (Rpm_capHead + 1) & (CAP_RING - 1);
+         if(next == Rpm_capTail)
+            Rpm_capLost++;
+         else
+         {
+            Rpm_capLo[Rpm_capHead] = (unsigned short)stamp;
+            Rpm_capHi[Rpm_capHead] = (unsigned char)(stamp >> 16);
+            Rpm_capHead = next;
+            if(((next - Rpm_capTail) & (CAP_RING - 1)) == CAP_RING / 2)
+               SYS_WAKE();
+         }
+         P2OUT ^= BIT1;   // toggle status LED
+      }
+      else if(P1IN & RPM_IN)
+      {
+         stamp = RpmNow();
+         if(GlitchMode == FILTER_OFF || !RpmGlitch(stamp))
+         {
+            Rpm_cnt++;   /* Increment counter */
+            RpmAlive(stamp);
+            RpmTrip(stamp);
+            RpmRing(stamp);
+            P2OUT ^= BIT1;   // toggle status LED on counted pulses only
+         }
+      }
+
+      P1IFG &= ~RPM_IN;  /* Reset I/O interrupt on P1.1 */
+   }
+
+   if(P1IFG & P1IE & KEY_P1_MASK)
+      KeyPort1();
+
+   SYS_WAKE_POSTED();
+}
+
+/*
+ *  This code is documented using DoxyGen
+ *  (http://www.stack.nl/~dimitri/doxygen/index.html)
+ */
@@ -0,0 +1,99 @@
+/**
+ *  @file rpm.h
+ *  @author TheFwGuy
+ *  @version 1.0
+ *  @date October 2026
+ *  @brief Header file for the rpm.c
+ */
+#ifndef __RPM_H
+#define __RPM_H
+
+/* definitions */
+
+#define MAX_MAGNETS     8        /* Highest NumMagnets value, size of the edge ring */
+#define MAX_ACQ_TIME    10       /* Highest AcqSecTime value */
+#define MAX_BINS        (MAX_ACQ_TIME * BINS_PER_SEC)  /* Size of the bin ring */
+
+// MEASUREMENT MODE
+#define MEAS_GATE       0        /* Count Hall edges over AcqSecTime */
+#define MEAS_PERIOD     1        /* Time the Hall edges with the Timer_A capture */
+#define MEAS_HWCOUNT    2        /* Count the Hall edges with Timer_B (TBCLK on P4.7) */
+#define MEAS_AUTO       3        /* Capture gate sized from the edge rate */
+#define MEAS_NUM        4
+
+// GLITCH FILTER (gate and period modes)
+#define FILTER_OFF      0        /* Every edge is counted */
+#define FILTER_FIXED    1        /* Reject edges closer than RPM_GLITCH_TICKS */
+#define FILTER_AUTO     2        /* Reject edges closer than 1/4 of the edge period */
+#define FILTER_NUM      3
+
+#define RPM_GLITCH_TICKS 8       /* Minimum edge period, 244 us (up to 4 kHz) */
+
+// STALL DETECTION
+#define RPM_STALL_MULT  4        /* Edge periods with no edge before a stall */
+#define RPM_STALL_MIN   32UL     /* Shortest stall timeout, 1 ms */
+#define RPM_STALL_MAX   131072UL /* Longest stall timeout, 4 s, or the gate window */
+
+// SPEED TRIP
+#define TRIP_OFF        0
+#define TRIP_OVER       1        /* Trip above TripRpm */
+#define TRIP_UNDER      2        /* Trip below TripRpm */
+#define TRIP_NUM        3
+
+#define RPM_TRIP_HYST   5        /* Release 1/32 of the limit (3%) past the trip point */
+#define MAX_TRIP_RPM    60000u
+
+// EDGE CAPTURE
+#define CAP_RING        64       /* Edge timestamps buffered (power of 2) */
+
+// MAGNET SPACING CALIBRATION (period mode)
+#define CAL_REVS        64       /* Revolutions averaged by the calibration */
+#define CAL_ONE         32768u   /* Weight of an evenly spaced magnet (Q15) */
+#define CAL_MIN         (CAL_ONE / 2)            /* Weights allowed, excluded */
+#define CAL_MAX         (CAL_ONE + CAL_ONE / 2)
+#define CAL_OFF         0xFF     /* No calibration table in use */
+
+/* Ticks of one revolution at 1 RPM (60 * 32768) */
+#define RPM_TICKS_REV   1966080UL
+
+/* RPM x 10 for one revolution lasting one Timer_A tick (60 * 10 * 32768) */
+#define RPM10_TICKS     19660800UL
+
+/* Highest edge count accepted by RpmTicksTenths() (no 32 bit overflow) */
+#define RPM_MAX_EDGES   (0xFFFFFFFFUL / RPM10_TICKS)
+
+/* Auto mode gate, at least 1024 ticks (31 ms) for a 0.1% resolution */
+#define RPM_AUTO_TICKS  1024UL
+
+/* Reading published by the interrupt routines */
+typedef struct
+{
+   unsigned long count;    /* Edges (counting modes) or edge intervals (period mode) */
+   unsigned long gate;     /* Timer_A ticks covered by count */
+   unsigned long stamp;    /* Time base at the end of the gate */
+} RpmSnap;
+
+/* Shared with the interrupt routines */
+extern volatile unsigned char  Rpm_seq;
+extern volatile unsigned short Rpm_reject;
+extern volatile unsigned char  Rpm_stall;
+extern volatile unsigned char  Rpm_trip;
+extern volatile unsigned short Rpm_capLost;
+extern volatile unsigned char  Rpm_calRevs;
+
+/*
+ *  Function prototypes
+ */
+void RpmStart(void);
+unsigned long RpmGateTenths(unsigned long count);
+unsigned long RpmTicksTenths(unsigned long period, unsigned char edges);
+unsigned long RpmTenths(const RpmSnap *snap);
+unsigned char RpmRead(RpmSnap *snap, unsigned char *seq);
+unsigned long RpmTime(void);
+void RpmCaptureStart(void);
+void RpmCaptureStop(void);
+unsigned char RpmCaptureGet(unsigned long *stamp);
+void RpmCalStart(void);
+unsigned char RpmCalEnd(void);
+
+#endif
@@ -7,134 +7,295 @@
  *
  */
 
-#include <stdio.h>
-#include <string.h>
 #include "system.h"
 #include "lcd_new.h"
-#include <io.h>
-#include <signal.h>
-/*
- *  Global defines
- */
-
-#define DELAY_1   0
+#include "rpm.h"
+#include "keys.h"
+#include "stats.h"
+#include "hal.h"
 
 // Measurement variables
 extern unsigned char NumMagnets; /* Number of magnets */
 extern unsigned char AcqSecTime; /* Acquisition time in seconds */
+extern unsigned char RefreshBins; /* Bins between readings */
+extern unsigned char MeasMode;   /* Measurement mode */
+extern unsigned char GlitchMode; /* Hall glitch filter */
+extern unsigned char TripMode;   /* Speed trip */
+extern unsigned short TripRpm;   /* Speed trip threshold */
+extern unsigned char StatTime;   /* Statistics interval */
+extern unsigned char AutoStart;  /* Measure at power up */
+
+static const char *ModeName[MEAS_NUM] =
+{
+   " Mode : Gate",
+   " Mode : Period",
+   " Mode : HW cnt",
+   " Mode : Auto"
+};
+
+static const char *FilterName[FILTER_NUM] =
+{
+   " Filter : Off",
+   " Filter : Fix",
+   " Filter : Auto"
+};
 
-// simple delay
-void DelayN(unsigned long a);
+static const char *TripName[TRIP_NUM] =
+{
+   " Trip : Off",
+   " Trip : Over",
+   " Trip : Under"
+};
+
+// Setting rows, the last one is not selectable
+#define SET_MAGNETS     0
+#define SET_WINDOW      1
+#define SET_MODE        2
+#define SET_REFRESH     3
+#define SET_FILTER      4
+#define SET_TRIP        5
+#define SET_TRIP_RPM    6
+#define SET_STATS       7
+#define SET_BOOT        8
+#define SET_EXIT        9
+#define SET_ROWS        10
+
+#define LCD_ROWS        6     /* text rows on the display */
+
+/**
+ *  @fn SetRow
+ *  @brief The function draws a setting row
+ *
+ *  @param row   display row
+ *  @param item  setting
+ *  @return none
+ */
+static void SetRow(unsigned char row, unsigned char item)
+{
+   /*
+    *  Max length
+    * "12345678901234"
+    */
+   switch(item)
+   {
+      case SET_MAGNETS:
+         LCDStr ( row, (unsigned char *)" Magnets :" );
+         LCDNum ( 10, row, NumMagnets, 2, 0 );
+         break;
+
+      case SET_WINDOW:
+         LCDStr ( row, (unsigned char *)" Window (s):" );
+         LCDNum ( 12, row, AcqSecTime, 2, 0 );
+         break;
+
+      case SET_MODE:
+         LCDStr ( row, (unsigned char *)ModeName[MeasMode] );
+         break;
+
+      case SET_REFRESH:
+         LCDStr ( row, (unsigned char *)" Upd (ms):" );
+         LCDNum ( 10, row, RefreshBins * BIN_MS, 4, 0 );
+         break;
+
+      case SET_FILTER:
+         LCDStr ( row, (unsigned char *)FilterName[GlitchMode] );
+         break;
+
+      case SET_TRIP:
+         LCDStr ( row, (unsigned char *)TripName[TripMode] );
+         break;
+
+      case SET_TRIP_RPM:
+         LCDStr ( row, (unsigned char *)" Limit :" );
+         LCDNum ( 8, row, TripRpm, 6, 0 );
+         break;
+
+      case SET_STATS:
+         if(StatSecs[StatTime])
+         {
+            LCDStr ( row, (unsigned char *)" Stats (s):" );
+            LCDNum ( 11, row, StatSecs[StatTime], 3, 0 );
+         }
+         else
+            LCDStr ( row, (unsigned char *)" Stats : Cont" );
+         break;
+
+      case SET_BOOT:
+         if(AutoStart)
+            LCDStr ( row, (unsigned char *)" Boot : Meas" );
+         else
+            LCDStr ( row, (unsigned char *)" Boot : Menu" );
+         break;
+
+      default:
+         LCDStr ( row, (unsigned char *)" Press to exit" );
+         break;
+   }
+}
+
+/**
+ *  @fn TripStep
+ *  @brief The function gives the trip threshold step around a value
+ *
+ *  @param rpm  threshold
+ *  @return step in RPM
+ */
+static unsigned short TripStep(unsigned short rpm)
+{
+   if(rpm < 1000)
+      return 10;
+   if(rpm < 10000)
+      return 100;
+   return 1000;
+}
 
 /**
  *  @fn SetParam
  *  @brief The function display the set menu and waits for a command
  *
- *  The function display the menu and then wait
+ *  The function display the menu and then wait. The rows scroll when
+ *  the cursor moves past the bottom of the display.
  *  @param none
  *  @return none
  */
 void SetParam(void)
 {
-   unsigned char locPos = 1;
+   unsigned char locPos = 0;
+   unsigned char top = 0;
    unsigned char display = 1;
-   char press_up   = 1;
-   char press_down = 1;
-   char press_left = 1;
-   char press_right = 1;
-   char tmpBuf[20];
-
-   //Wait if pushbutton is pressed
-   while((P2IN&BIT0) == 0);
+   unsigned char key;
+   unsigned char row;
 
    // loop for choose
-   do
+   for(;;)
    {
-      /*
-       *  Max length
-       * "12345678901234"
-       */
       if(display)
       {
+         // Keep a row below the cursor, or the last rows
+         top = (locPos > LCD_ROWS - 2) ? locPos - (LCD_ROWS - 2) : 0;
+         if(top > SET_ROWS - LCD_ROWS)
+            top = SET_ROWS - LCD_ROWS;
+
          LCDClear();
-         sprintf(tmpBuf, " Magnets : %u", NumMagnets);
-         LCDStr ( 0, (unsigned char *)tmpBuf );
-         sprintf(tmpBuf, " Timer (s): %u", AcqSecTime);
-         LCDStr ( 1, (unsigned char *)tmpBuf );
-         LCDStr ( 2, (unsigned char *)" Press to exit" );
-         LCDStr ( locPos-1, (unsigned char *)">" );
+         for(row = 0; row < LCD_ROWS; row++)
+            SetRow(row, top + row);
+         LCDStr ( locPos - top, (unsigned char *)">" );
          LCDUpdate();
          display = 0;
       }
 
-      // Up
-      if((!(P1IN&BIT6))&&(press_up==1))
+      key = KeyGet();
+      if(key == KEY_NONE)
       {
-         locPos--;
-         if(locPos<1) locPos = 1;
-
-         press_up = 0;
-         display = 1;
-     }
-     if((P1IN&BIT6)&&(press_up==0))
-     {
-        press_up = 1;
-     }
-
-     // Down
-     if((!(P1IN&BIT5))&&(press_down==1))
-     {
-        locPos++;
-        if(locPos>2) locPos = 2;
-
-        press_down = 0;
-        display = 1;
-     }
-
-     if((P1IN&BIT5)&&(press_down==0))
-     {
-        press_down = 1;
-     }
-
-     if(press_down == 1 && press_up == 1)
-     {
-        // Left (increment value)
-        if((!(P1IN&BIT7))&&(press_left==1))
-        {
-           switch(locPos)
-           {
-               case 1:  /* Num magnets */
-                  if(NumMagnets < 8)
+         // Nothing to do until a key event
+         SysSleep(MODE_LPM3);
+         continue;
+      }
+      if(KEY_EV(key) == KEY_EV_RELEASE)
+         continue;
+
+      switch(KEY_ID(key))
+      {
+         case KEY_ID_UP:
+            if(locPos > 0)
+            {
+               locPos--;
+               display = 1;
+            }
+            break;
+
+         case KEY_ID_DOWN:
+            if(locPos < SET_EXIT - 1)
+            {
+               locPos++;
+               display = 1;
+            }
+            break;
+
+         case KEY_ID_LEFT:    /* increment value */
+            switch(locPos)
+            {
+               case SET_MAGNETS:
+                  if(NumMagnets < MAX_MAGNETS)
                   {
                      NumMagnets++;
                      display = 1;
                   }
                   break;
 
-               case 2:  /* Timer setting */
-                  if(AcqSecTime < 10)
+               case SET_WINDOW:
+                  if(AcqSecTime < MAX_ACQ_TIME)
                   {
                      AcqSecTime++;
                      display = 1;
                   }
                   break;
 
-              default:
-                 break;
-           }
-           press_left = 0;
-        }
-        if((P1IN&BIT7)&&(press_left==0))
-        {
-           press_left = 1;
-        }
+               case SET_MODE:
+                  if(MeasMode < MEAS_NUM - 1)
+                  {
+                     MeasMode++;
+                     display = 1;
+                  }
+                  break;
 
-        // Right (decrement value)
-        if((!(P1IN&BIT4))&&(press_right==1))
-        {
-           switch(locPos)
-           {
-               case 1:  /* Num magnets */
+               case SET_REFRESH:
+                  if(RefreshBins < BINS_PER_SEC)
+                  {
+                     RefreshBins <<= 1;
+                     display = 1;
+                  }
+                  break;
+
+               case SET_FILTER:
+                  if(GlitchMode < FILTER_NUM - 1)
+                  {
+                     GlitchMode++;
+                     display = 1;
+                  }
+                  break;
+
+               case SET_TRIP:
+                  if(TripMode < TRIP_NUM - 1)
+                  {
+                     TripMode++;
+                     display = 1;
+                  }
+                  break;
+
+               case SET_TRIP_RPM:
+                  if(TripRpm < MAX_TRIP_RPM)
+                  {
+                     TripRpm += TripStep(TripRpm);
+                     display = 1;
+                  }
+                  break;
+
+               case SET_STATS:
+                  if(StatTime < STAT_TIMES - 1)
+                  {
+                     StatTime++;
+                     display = 1;
+                  }
+                  break;
+
+               case SET_BOOT:
+                  if(!AutoStart)
+                  {
+                     AutoStart = 1;
+                     display = 1;
+                  }
+                  break;
+
+               default:
+                  break;
+            }
+            break;
+
+         case KEY_ID_RIGHT:   /* decrement value */
+            switch(locPos)
+            {
+               case SET_MAGNETS:
                   if(NumMagnets > 1)
                   {
                      NumMagnets--;
@@ -142,7 +303,7 @@ void SetParam(void)
                   }
                   break;
 
-               case 2:  /* Timer setting */
+               case SET_WINDOW:
                   if(AcqSecTime > 1)
                   {
                      AcqSecTime--;
@@ -150,17 +311,74 @@ void SetParam(void)
                   }
                   break;
 
-              default:
-                 break;
-           }
-           press_right = 0;
-        }
-        if((P1IN&BIT4)&&(press_right==0))
-        {
-           press_right = 1;
-        }
-     }
-  } while(P2IN&BIT0);
+               case SET_MODE:
+                  if(MeasMode > 0)
+                  {
+                     MeasMode--;
+                     display = 1;
+                  }
+                  break;
+
+               case SET_REFRESH:
+                  if(RefreshBins > 1)
+                  {
+                     RefreshBins >>= 1;
+                     display = 1;
+                  }
+                  break;
+
+               case SET_FILTER:
+                  if(GlitchMode > 0)
+                  {
+                     GlitchMode--;
+                     display = 1;
+                  }
+                  break;
+
+               case SET_TRIP:
+                  if(TripMode > 0)
+                  {
+                     TripMode--;
+                     display = 1;
+                  }
+                  break;
+
+               case SET_TRIP_RPM:
+                  if(TripRpm > 0)
+                  {
+                     TripRpm -= TripStep(TripRpm - 1);
+                     display = 1;
+                  }
+                  break;
+
+               case SET_STATS:
+                  if(StatTime > 0)
+                  {
+                     StatTime--;
+                     display = 1;
+                  }
+                  break;
+
+               case SET_BOOT:
+                  if(AutoStart)
+                  {
+                     AutoStart = 0;
+                     display = 1;
+                  }
+                  break;
+
+               default:
+                  break;
+            }
+            break;
+
+         case KEY_ID_PUSH:
+            return;
+
+         default:
+            break;
+      }
+   }
 }
 
 
@@ -0,0 +1,284 @@
+/**
+ *  @file stats.c
+ *  @author TheFwGuy
+ *  @version 1.0
+ *  @date October 2026
+ *  @brief Speed stability statistics
+ *
+ *  Every reading of the measurement mode set is added to running
+ *  statistics : mean and variance with the Welford update, minimum,
+ *  maximum and peak to peak. A sample costs one 32 bit division and one
+ *  16 x 16 bit multiplication, with no sample buffer, no 64 bit helpers and
+ *  no floating point. The mean is kept with 4 fractional bits, the sum of
+ *  the squared deviations with 8 in 32 bit, shifted right by an even count
+ *  when it would overflow (a stall among the readings) : the precision then
+ *  lost is far below the deviation shown. The square root for the standard
+ *  deviation is only computed for the display.
+ *
+ *  The statistics cover StatSecs[StatTime] seconds from the first reading,
+ *  then they are frozen, or run until the joystick press (0).
+ */
+
+#include "system.h"
+#include "lcd_new.h"
+#include "rpm.h"
+#include "keys.h"
+#include "stats.h"
+#include "telem.h"
+#include "hal.h"
+
+extern unsigned char StatTime;   /* Statistics interval */
+
+/* Statistics intervals in seconds, 0 = until the joystick press */
+const unsigned short StatSecs[STAT_TIMES] = { 0, 10, 30, 60, 300, 600 };
+
+/**
+ *  @fn StatReset
+ *  @brief The function clears the statistics
+ *
+ *  @param st  statistics
+ *  @return none
+ */
+void StatReset(Stat *st)
+{
+   st->n    = 0;
+   st->mean = 0;
+   st->rem  = 0;
+   st->m2   = 0;
+   st->sh   = 0;
+   st->min  = 0;
+   st->max  = 0;
+}
+
+/**
+ *  @fn StatBits
+ *  @brief The function counts the significant bits of a value
+ *
+ *  @param v  value
+ *  @return bits, 0 for 0
+ */
+static unsigned char StatBits(unsigned long v)
+{
+   unsigned char n = 0;
+
+   while(v)
+   {
+      v >>= 1;
+      n++;
+   }
+   return n;
+}
+
+/**
+ *  @fn StatAdd
+ *  @brief The function adds a sample to the statistics
+ *
+ *  The remainder of the mean update is carried to the next sample, so the
+ *  mean does not stop moving when the deviations get smaller than n.
+ *  The larger deviation of the Welford product is halved until the product
+ *  fits in STAT_PBITS, by an even count, the product and the sum are then
+ *  aligned on the larger shift.
+ *
+ *  @param st  statistics
+ *  @param x   sample (RPM x 10, up to STAT_MAX)
+ *  @return none
+ */
+void StatAdd(Stat *st, unsigned long x)
+{
+   long d;
+   long e;
+   long q;
+   unsigned long ad;
+   unsigned long ae;
+   unsigned char ba;
+   unsigned char be;
+   unsigned char k = 0;
+
+   if(x > STAT_MAX)
+      x = STAT_MAX;
+
+   if(st->n == 0 || x < st->min)
+      st->min = x;
+   if(st->n == 0 || x > st->max)
+      st->max = x;
+   st->n++;
+
+   d = (long)(x << 4) - st->mean;
+   st->rem  += d;
+   q = st->rem / (long)st->n;
+   st->mean += q;
+   st->rem  -= q * (long)st->n;
+   e = (long)(x << 4) - st->mean;
+
+   ad = d < 0 ? -d : d;
+   ae = e < 0 ? -e : e;
+   ba = StatBits(ad);
+   be = StatBits(ae);
+   while(ba + be > STAT_PBITS || (k & 1))
+   {
+      if(ba >= be)
+      {
+         ad >>= 1;
+         ba--;
+      }
+      else
+      {
+         ae >>= 1;
+         be--;
+      }
+      k++;
+   }
+   q = (long)(ad * ae);
+   if((d < 0) != (e < 0))
+      q = -q;
+
+   if(k > st->sh)
+   {
+      st->m2 = k - st->sh < 31 ? st->m2 >> (k - st->sh) : 0;
+      st->sh = k;
+   }
+   else
+      q = st->sh - k < 31 ? q >> (st->sh - k) : 0;
+
+   st->m2 += q;
+   if(st->m2 >= STAT_M2MAX)
+   {
+      st->m2 >>= 2;
+      st->sh  += 2;
+   }
+}
+
+/**
+ *  @fn StatMean
+ *  @brief The function gives the mean of the samples
+ *
+ *  @param st  statistics
+ *  @return mean, RPM x 100
+ */
+unsigned long StatMean(const Stat *st)
+{
+   return ((unsigned long)st->mean * 5 + 4) >> 3;
+}
+
+/**
+ *  @fn StatDev
+ *  @brief The function gives the standard deviation of the samples
+ *
+ *  Sample standard deviation (n - 1), the square root is computed bit by
+ *  bit and scaled back by half the shift of the sum.
+ *
+ *  @param st  statistics
+ *  @return standard deviation, RPM x 100
+ */
+unsigned long StatDev(const Stat *st)
+{
+   unsigned long v;
+   unsigned long bit = 1UL << 30;
+   unsigned long res = 0;
+
+   if(st->n < 2 || st->m2 <= 0)
+      return 0;
+   v = (unsigned long)st->m2 / (st->n - 1);
+
+   while(bit > v)
+      bit >>= 2;
+   while(bit)
+   {
+      if(v >= res + bit)
+      {
+         v  -= res + bit;
+         res = (res >> 1) + bit;
+      }
+      else
+         res >>= 1;
+      bit >>= 2;
+   }
+
+   /* Q4 RPM x 10 to RPM x 100 */
+   res <<= st->sh >> 1;
+   return (res * 5 + 4) >> 3;
+}
+
+/**
+ *  @fn Stats
+ *  @brief The function measures the RPM and shows its statistics
+ *
+ *  @param none
+ *  @return none
+ */
+void Stats(void)
+{
+   /*
+    *  Max length
+    * "12345678901234"
+    */
+   unsigned long limit = (unsigned long)StatSecs[StatTime] << 15;
+   unsigned long start = 0;
+   unsigned long secs = 0;
+   unsigned char seq = Rpm_seq;
+   unsigned char done = 0;
+   unsigned char redraw = 0;
+   unsigned long rpm10;
+   RpmSnap snap;
+   Stat st;
+
+   StatReset(&st);
+
+   LCDClear();
+   LCDStr ( 0, (unsigned char *)" N=      t=" );
+   LCDStr ( 1, (unsigned char *)" Mean=" );
+   LCDStr ( 2, (unsigned char *)" SD  =" );
+   LCDStr ( 3, (unsigned char *)" Min =" );
+   LCDStr ( 4, (unsigned char *)" Max =" );
+   LCDStr ( 5, (unsigned char *)" P-P =" );
+   LCDUpdate();
+
+   //until the joystick is pressed
+   while(KeyGet() != (KEY_ID_PUSH | KEY_EV_PRESS))
+   {
+      if(RpmRead(&snap, &seq) && !done)
+      {
+         if(st.n == 0)
+            start = snap.stamp;
+
+         if(limit && snap.stamp - start >= limit)
+         {
+            done = 1;
+            secs = StatSecs[StatTime];
+         }
+         else
+         {
+            rpm10 = RpmTenths(&snap);
+            StatAdd(&st, rpm10);
+            TelemSend(&snap, rpm10);
+            secs = (snap.stamp - start) >> 15;
+         }
+         redraw = 1;
+      }
+
+      // The readings go on while the figures are sent
+      if(redraw && !LCDBusy())
+      {
+         if(done)
+            LCDStr ( 0, (unsigned char *)" Done  N=" );
+         LCDNum ( done ? 9 : 3, 0, st.n > 99999UL ? 99999UL : st.n, 5, 0 );
+         if(!done)
+            LCDNum ( 11, 0, secs > 999 ? 999 : secs, 3, 0 );
+         LCDNum ( 6, 1, StatMean(&st), 8, 2 );
+         LCDNum ( 6, 2, StatDev(&st), 8, 2 );
+         LCDNum ( 6, 3, st.min, 8, 1 );
+         LCDNum ( 6, 4, st.max, 8, 1 );
+         LCDNum ( 6, 5, st.max - st.min, 8, 1 );
+         LCDUpdate();
+         redraw = 0;
+      }
+
+      // Sleep until a new reading or a key
+      SysSleep(MODE_LPM3);
+   }
+}
+
+/*
+ *  This code is documented using DoxyGen
+ *  (http://www.stack.nl/~dimitri/doxygen/index.html)
+ */
@@ -0,0 +1,41 @@
+/**
+ *  @file stats.h
+ *  @author TheFwGuy
+ *  @version 1.0
+ *  @date October 2026
+ *  @brief Header file for the stats.c
+ */
+#ifndef __STATS_H
+#define __STATS_H
+
+/* definitions */
+
+#define STAT_TIMES      6        /* Statistics intervals, see StatSecs */
+#define STAT_MAX        0x7FFFFFFUL   /* Highest sample (RPM x 10) */
+#define STAT_PBITS      30            /* Bits of a Welford product */
+#define STAT_M2MAX      0x40000000L   /* Sum limit, a product can be added */
+
+/* Running statistics of RPM x 10 samples */
+typedef struct
+{
+   unsigned long  n;       /* Samples */
+   long           mean;    /* Mean, Q4 */
+   long           rem;     /* Remainder of the mean, mean + rem / n is exact */
+   long           m2;      /* Sum of the squared deviations from the mean, Q8 */
+   unsigned char  sh;      /* m2 is shifted right by sh (even) */
+   unsigned long  min;
+   unsigned long  max;
+} Stat;
+
+extern const unsigned short StatSecs[STAT_TIMES];
+
+/*
+ *  Function prototypes
+ */
+void StatReset(Stat *st);
+void StatAdd(Stat *st, unsigned long x);
+unsigned long StatMean(const Stat *st);
+unsigned long StatDev(const Stat *st);
+void Stats(void);
+
+#endif
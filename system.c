@@ -6,26 +6,31 @@
  *  @brief Initialization functions for the Olimex MSP430F169 LCD board 
  */
 #include "system.h"
+#include "rpm.h"
+#include "clock.h"
 #define __MSP430_HAS_BC2__
-#include <msp430x16x.h>
+#include "hal.h"
 
-extern unsigned char AcqSecTime;
+extern unsigned char MeasMode;
+
+volatile unsigned char SysEvent;   /* An interrupt routine has work for the main loop */
+unsigned char SysPosted;           /* Event posted by a function called from a routine */
 
 /**
- *  @fn InitFreq
- *  @brief The function initialize the system clock
+ *  @fn FreqStart
+ *  @brief The function sets up the system clock, without waiting for the crystal
  *
  *  The program uses two main clock.
  *  The DCO set for a low/middle range frequency (around 800kHz) and the 32Khz crystal
  *  The DCO clock handles the MCLK and SMCLK and the 32kHz crystal the ACLK
+ *  ACLK is not divided, so Timer_A can timestamp the Hall edges at 30.5 us
+ *  The DCO is then changed by the clock profiles (clock.c)
  *
  *  @param none
  *  @return none
  */
-void InitFreq(void)
+void FreqStart(void)
 {
-   int alert = 0;
-
    WDTCTL = WDTPW + WDTHOLD;   /* Stop watchdog timer */
 
    /*
@@ -38,11 +43,11 @@ void InitFreq(void)
 
    /*
     *  Basic Clock System Control Register 1
-    *  RSELx = 7, DIVAx = 3, XTS = 0, XT20FF = 1
+    *  RSELx = 7, DIVAx = 0, XTS = 0, XT20FF = 1
     *  description:
-    *  XT2 off, ACLK divide by 8
+    *  XT2 off, ACLK not divided (32768 Hz)
     */
-   BCSCTL1 = 0xB7;
+   BCSCTL1 = 0x87;
 
    /*
     *  Basic Clock System Control Register 2
@@ -60,31 +65,117 @@ void InitFreq(void)
     */
    BCSCTL3 = 0x0C;
 
+   Clock_now = CLK_NORMAL;
+}
+
+/**
+ *  @fn FreqStable
+ *  @brief The function checks the 32kHz crystal
+ *
+ *  The oscillator fault flag is cleared and read back: the hardware sets it
+ *  again as long as the crystal does not oscillate properly. Only OFIFG is
+ *  cleared, the USART0 flag may already be in use by the LCD.
+ *
+ *  @param none
+ *  @return 1 if the crystal is stable
+ */
+unsigned char FreqStable(void)
+{
+   IFG1 &= ~OFIFG;
+   return (IFG1 & OFIFG) ? 0 : 1;
+}
+
+/**
+ *  @fn InitFreq
+ *  @brief The function initialize the system clock and waits for the crystal
+ *
+ *  @param none
+ *  @return none
+ */
+void InitFreq(void)
+{
+   int alert = 0;
+
+   FreqStart();
+
    /* As suggested by the main MSP430 datasheet */
    do
    {
-      IFG1 = 0;
       alert++;
-   } while((IFG1 & OFIFG) != 0 && alert < 50000);
+   } while(!FreqStable() && alert < 50000);
 }
 
 /**
  *  @fn InitTimer
- *  @brief The function initialize the Timer A0
+ *  @brief The function initialize the Timer A and the Hall sensor input
+ *
+ *  Timer A counts continuously on ACLK. The overflow interrupt extends it
+ *  to 32 bit and TACCR1 generates the 125 ms bin tick.
+ *  The timer is cleared only at the first call : when the measurement mode
+ *  changes TAR and Rpm_timeHi keep running, so the time base used for the
+ *  telemetry, the log and the statistics never goes back.
+ *  In period and auto modes P1.1 is routed to the TACCR0 capture unit, in
+ *  hardware count mode the Hall sensor clocks Timer B through P4.7 (TBCLK),
+ *  otherwise P1.1 generates a port interrupt for every edge.
  *
  *  @param none
  *  @return none
  */
 void InitTimer(void)
 {
+   unsigned short now;
+
    /* Setting timer A */
 
-   TACTL = TASSEL_1 + ID_3 + MC_1;    /* Uses ACLK, divide by 8, count in up mode */
-   TACCTL0 = CCIE;                    /* Use TACCR0 to generate interrupt */
-   TACCR0 = TMRVALUE * AcqSecTime;    /* 1s */
+   if((TACTL & MC_3) != MC_2)
+   {
+      TACTL = TASSEL_1 + ID_0 + MC_2 + TACLR + TAIE;  /* Uses ACLK, continuous mode, overflow interrupt */
+      TACCR1 = TMRVALUE;              /* 125 ms bin */
+   }
+   else
+   {
+      do
+      {
+         now = TAR;                   /* ACLK, asynchronous to MCLK */
+      } while(now != TAR);
+      TACCR1 = now + TMRVALUE;
+   }
+   TACCTL1 = CCIE;                    /* Use TACCR1 to generate interrupt */
+   TACCTL2 = 0;                       /* TACCR2 stall deadline, armed by RpmStart */
 
-   /*  NORMAL MODE */
-   TACCTL0 &= ~0x0080;                /* Disable Out0 */
+   /* Setting timer B */
+
+   if(MeasMode == MEAS_HWCOUNT)
+   {
+      P4DIR &= ~RPM_HW_IN;            /* P4.7 as input */
+      P4SEL |= RPM_HW_IN;             /* P4.7 is TBCLK */
+      TBCTL = TBSSEL_0 + MC_2 + TBCLR + TBIE;      /* Count TBCLK edges, overflow interrupt */
+   }
+   else
+   {
+      TBCTL = TBCLR;                  /* Timer B stopped */
+      P4SEL &= ~RPM_HW_IN;
+   }
+
+   if(MeasMode == MEAS_PERIOD || MeasMode == MEAS_AUTO)
+   {
+      P1IE &= ~RPM_IN;                /* No port interrupt on P1.1 */
+      P1SEL |= RPM_IN;                /* P1.1 is TA0 */
+      TACCTL0 = CM_1 + CCIS_0 + SCS + CAP + CCIE;  /* Capture rising edges on CCI0A */
+   }
+   else if(MeasMode == MEAS_HWCOUNT)
+   {
+      TACCTL0 = 0;
+      P1IE &= ~RPM_IN;                /* No port interrupt on P1.1 */
+      P1SEL &= ~RPM_IN;
+   }
+   else
+   {
+      TACCTL0 = 0;
+      P1SEL &= ~RPM_IN;               /* P1.1 is I/O */
+      P1IFG &= ~RPM_IN;
+      P1IE |= RPM_IN;                 /* Enable interrupt on P1.1 */
+   }
 }
 
 /**
@@ -121,7 +212,52 @@ void InitPeriph(void)
    P2OUT &= ~BIT3;   /* low */
    P2DIR |= BIT3;    
 
+   /* Set speed trip output */
+   P2OUT &= ~TRIP_OUT;   /* low (not tripped) */
+   P2DIR |= TRIP_OUT;
+
    P1IES &= ~BIT1;   /* Set P1.1 interrupt generation on the low-to-high transition */
    P1IE |= BIT1;     /* Enable interrupt on P1.1 */
 }
 
+/**
+ *  @fn SysSleep
+ *  @brief The function sleeps until an interrupt routine has work for the main loop
+ *
+ *  The CPU is put in the requested low power mode, with the interrupts enabled
+ *  in the same instruction, so an event can not be missed between the check
+ *  and the sleep. If an event happened since the last call the function
+ *  returns at once. While the USART0 is sending to the LCD the SMCLK must
+ *  keep running, so the CPU does not go below LPM0.
+ *  Must be called with the interrupts enabled.
+ *
+ *  @param mode  deepest low power mode (MODE_ACTIVE does not sleep)
+ *  @return none
+ */
+void SysSleep(unsigned char mode)
+{
+   unsigned short bits;
+
+   if(mode != MODE_ACTIVE && (IE1 & UTXIE0))
+      mode = MODE_LPM0;
+
+   switch(mode)
+   {
+      case MODE_LPM0:   bits = LPM0_bits;   break;
+      case MODE_LPM1:   bits = LPM1_bits;   break;
+      case MODE_LPM2:   bits = LPM2_bits;   break;
+      case MODE_LPM3:   bits = LPM3_bits;   break;
+      case MODE_LPM4:   bits = LPM4_bits;   break;
+      default:          return;
+   }
+
+   dint();
+   if(SysEvent)
+      eint();
+   else
+      _BIS_SR(bits + GIE);
+   SysEvent = 0;
+   SYS_BARRIER();
+}
+
+
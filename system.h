@@ -29,15 +29,46 @@
 #define BIT_6  0x40
 #define BIT_7  0x80
 
-#define TMRVALUE        512      /* Timer will generate a interrupt every 1 s */
+#define TMRVALUE        4096u    /* Timer A ticks in a bin, 125 ms (ACLK, 32768 Hz) */
+#define BINS_PER_SEC    8        /* Bins in a second */
+#define BIN_MS          125      /* Bin length in ms */
 #define RPM_IN          BIT1     /* Bit used to read Hall sensor */
+#define RPM_HW_IN       BIT7     /* P4 bit wired to the Hall sensor for hardware count */
+#define TRIP_OUT        BIT4     /* P2 bit of the speed trip output (high = tripped) */
+
+/* Set by the interrupt routines that have work for the main loop */
+extern volatile unsigned char SysEvent;
+
+/* Set by the functions called from an interrupt routine, see SYS_POST */
+extern unsigned char SysPosted;
+
+/* From an interrupt routine: wake the main loop when the routine returns */
+#define SYS_WAKE()      do { SysEvent = 1; LPM3_EXIT; } while(0)
+
+/*
+ *  LPM3_EXIT edits the status register saved in the frame of the interrupt
+ *  routine, so it only works in the body of the routine itself. A function
+ *  called by the routine posts the event with SYS_POST, the routine wakes
+ *  the main loop with SYS_WAKE_POSTED before returning.
+ */
+#define SYS_POST()        do { SysEvent = 1; SysPosted = 1; } while(0)
+#define SYS_WAKE_POSTED() do { if(SysPosted) { SysPosted = 0; LPM3_EXIT; } } while(0)
+
+/*
+ *  Compiler barrier: the memory handed over to or from an interrupt routine
+ *  is written before and read again after it, at any optimization level
+ */
+#define SYS_BARRIER()   __asm__ __volatile__("" ::: "memory")
 
 /*
  *  Function prototypes
  */
+void FreqStart(void);
+unsigned char FreqStable(void);
 void InitFreq(void);
 void InitTimer(void);
 void InitPeriph(void);
+void SysSleep(unsigned char mode);
 
 #endif
 
@@ -0,0 +1,191 @@
+/**
+ *  @file telem.c
+ *  @author TheFwGuy
+ *  @version 1.0
+ *  @date October 2026
+ *  @brief Telemetry stream of the measurements on the USART1
+ *
+ *  The USART1 is an UART at 9600 8N1 clocked by ACLK, so it keeps sending
+ *  in LPM3. Every reading is packed in a binary frame (TELEM_LEN bytes) :
+ *    0xA5 0x5A  seq  flags  stamp  count  gate  rpm10  checksum
+ *  with the four 32 bit fields little endian, flags = stall | trip | mode
+ *  and the checksum the low byte of the sum from seq to rpm10.
+ *  The frame is copied in a transmit ring, written only by the main loop
+ *  (TelemHead) and emptied only by the interrupt routine (TelemTail), so
+ *  the measurement never waits for the line. When the ring has no room
+ *  for a whole frame the frame is dropped, but its sequence number is used
+ *  anyway and the decoder sees the gap.
+ *  Bulk transfers (the log dump) go through TelemPut and sleep until the
+ *  interrupt routine has sent half of the ring.
+ */
+
+#include "system.h"
+#include "rpm.h"
+#include "telem.h"
+#include "hal.h"
+
+extern unsigned char MeasMode;   /* Measurement mode */
+
+volatile unsigned char TelemRing[TELEM_RING];
+volatile unsigned char TelemHead;   /* Next byte to write (main loop) */
+volatile unsigned char TelemTail;   /* Next byte to send (interrupt) */
+volatile unsigned char TelemWait;   /* Main loop waiting for room */
+unsigned char  TelemSeq;            /* Sequence number of the next frame */
+unsigned short Telem_drop;          /* Frames dropped, ring full */
+
+/**
+ *  @fn TelemInit
+ *  @brief The function sets the USART1 as UART transmitter
+ *
+ *  To be called after LCDInit, that writes the whole ME2.
+ *
+ *  @param none
+ *  @return none
+ */
+void TelemInit(void)
+{
+   P3SEL |= UTXD1;
+   P3DIR |= UTXD1;
+
+   U1CTL  = CHAR | SWRST;   // 8 bit, no parity, 1 stop
+   U1TCTL = SSEL0;          // ACLK
+   U1BR0  = 0x03;           // 32768 / 9600 = 3.41
+   U1BR1  = 0x00;
+   U1MCTL = 0x4A;           // Modulation
+   ME2   |= UTXE1;          // Enable the transmitter
+   U1CTL &= ~SWRST;
+
+   TelemHead = 0;
+   TelemTail = 0;
+   TelemWait = 0;
+   TelemSeq  = 0;
+   Telem_drop = 0;
+}
+
+/**
+ *  @fn TelemPut32
+ *  @brief The function stores a 32 bit value little endian
+ *
+ *  @param p      destination
+ *  @param val    value
+ *  @return none
+ */
+static void TelemPut32(unsigned char *p, unsigned long val)
+{
+   p[0] = (unsigned char)val;
+   p[1] = (unsigned char)(val >> 8);
+   p[2] = (unsigned char)(val >> 16);
+   p[3] = (unsigned char)(val >> 24);
+}
+
+/**
+ *  @fn TelemPut
+ *  @brief The function queues bytes for the USART1
+ *
+ *  Nothing is queued if the ring has no room for all the bytes: the caller
+ *  can then sleep, it is woken up when half of the ring is free.
+ *
+ *  @param buf    bytes to send
+ *  @param len    number of bytes (less than TELEM_RING)
+ *  @return 1 if queued, 0 if no room
+ */
+unsigned char TelemPut(const unsigned char *buf, unsigned char len)
+{
+   unsigned char head = TelemHead;
+
+   // Set before the check, so the interrupt routine can not miss it
+   TelemWait = 1;
+   SYS_BARRIER();
+
+   // Room left, one byte always free to tell full from empty
+   if(((TelemTail - head - 1) & (TELEM_RING - 1)) < len)
+      return 0;
+   TelemWait = 0;
+
+   while(len--)
+   {
+      TelemRing[head] = *buf++;
+      head = (head + 1) & (TELEM_RING - 1);
+   }
+   TelemHead = head;
+
+   /*
+    *  Start the transmission if the interrupt routine is idle, it stops
+    *  itself when the ring is empty. The flag is forced only then, when
+    *  U1TXBUF is sure to be empty.
+    */
+   SYS_BARRIER();
+   if(!(IE2 & UTXIE1))
+   {
+      IFG2 |= UTXIFG1;
+      IE2  |= UTXIE1;
+   }
+   return 1;
+}
+
+/**
+ *  @fn TelemSend
+ *  @brief The function queues a reading for the telemetry stream
+ *
+ *  @param snap   reading
+ *  @param rpm10  RPM x 10 of the reading
+ *  @return none
+ */
+void TelemSend(const RpmSnap *snap, unsigned long rpm10)
+{
+   unsigned char frame[TELEM_LEN];
+   unsigned char sum = 0;
+   unsigned char i;
+
+   frame[0] = TELEM_SYNC0;
+   frame[1] = TELEM_SYNC1;
+   frame[2] = TelemSeq++;
+   frame[3] = (MeasMode << 2) | (Rpm_trip ? TELEM_TRIP : 0) | (Rpm_stall ? TELEM_STALL : 0);
+   TelemPut32(&frame[4], snap->stamp);
+   TelemPut32(&frame[8], snap->count);
+   TelemPut32(&frame[12], snap->gate);
+   TelemPut32(&frame[16], rpm10);
+   for(i = 2; i < TELEM_LEN - 1; i++)
+      sum += frame[i];
+   frame[TELEM_LEN - 1] = sum;
+
+   if(!TelemPut(frame, TELEM_LEN))
+   {
+      TelemWait = 0;
+      Telem_drop++;
+   }
+}
+
+/**
+ * USART1 TX
+ * @brief USART1 transmit interrupt service routine
+ *
+ * This function sends the next byte of the ring.
+ *
+ * @param none
+ * @return None
+ */
+interrupt(USART1TX_VECTOR) USART1TX_ISR(void)
+{
+   unsigned char tail = TelemTail;
+
+   if(tail == TelemHead)
+   {
+      IE2 &= ~UTXIE1;
+      return;
+   }
+
+   U1TXBUF   = TelemRing[tail];
+   TelemTail = tail = (tail + 1) & (TELEM_RING - 1);
+
+   if(TelemWait && ((TelemHead - tail) & (TELEM_RING - 1)) <= TELEM_RING / 2)
+   {
+      TelemWait = 0;
+      SYS_WAKE();
+   }
+}
+
+/*
+ *  This code is documented using DoxyGen
+ *  (http://www.stack.nl/~dimitri/doxygen/index.html)
+ */
@@ -0,0 +1,35 @@
+/**
+ *  @file telem.h
+ *  @author TheFwGuy
+ *  @version 1.0
+ *  @date October 2026
+ *  @brief Header file for the telem.c
+ */
+#ifndef __TELEM_H
+#define __TELEM_H
+
+/* definitions */
+
+#define UTXD1           BIT_6    /* P3.6 - USART1 TXD */
+
+#define TELEM_RING      128      /* Bytes of the transmit ring, power of two */
+
+// FRAME (little endian)
+#define TELEM_SYNC0     0xA5
+#define TELEM_SYNC1     0x5A
+#define TELEM_LEN       21       /* Sync, seq, flags, 4 x u32, checksum */
+
+#define TELEM_STALL     0x01     /* Flags : rotor stopped */
+#define TELEM_TRIP      0x02     /* Flags : trip output high */
+#define TELEM_MODE(f)   (((f) >> 2) & 0x07)   /* Flags : measurement mode */
+
+/*
+ *  Function prototypes
+ */
+void TelemInit(void);
+unsigned char TelemPut(const unsigned char *buf, unsigned char len);
+void TelemSend(const RpmSnap *snap, unsigned long rpm10);
+
+extern unsigned short Telem_drop;
+
+#endif